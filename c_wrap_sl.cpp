@@ -3,6 +3,7 @@
 #include "shader/Shape2Shader.h"
 #include "shader/Shape3Shader.h"
 #include "shader/Sprite2Shader.h"
+#include "shader/SpritePool.h"
 #include "shader/Sprite3Shader.h"
 #include "shader/BlendShader.h"
 #include "shader/FilterShader.h"
@@ -14,6 +15,10 @@
 #include "shader/BurningMapProg.h"
 #include "render/RenderContext.h"
 #include "render/RenderShader.h"
+#include "render/HeadlessBackend.h"
+#include "render/RenderStat.h"
+#include "utility/Trace.h"
+#include "utility/FrameArena.h"
 
 #include <sm_c_vector.h>
 #include <sm_c_matrix.h>
@@ -32,6 +37,16 @@ int sl_create(int max_texture)
 	return ShaderMgr::Instance()->CreateContext(max_texture);
 }
 
+extern "C"
+int sl_create_with_backend(int max_texture, enum SL_RENDER_BACKEND backend)
+{
+	RenderBackend* rb = NULL;
+	if (backend == SLRB_HEADLESS) {
+		rb = new HeadlessBackend;
+	}
+	return ShaderMgr::Instance()->CreateContext(max_texture, rb);
+}
+
 extern "C"
 void sl_release()
 {
@@ -125,6 +140,11 @@ void sl_on_modelview2(float x, float y, float sx, float sy) {
 	sl::SubjectMVP2::Instance()->NotifyModelview(x, y, sx, sy);
 }
 
+extern "C"
+void sl_set_pre_transform2(int enable) {
+	sl::SubjectMVP2::Instance()->SetPreTransform(enable != 0);
+}
+
 extern "C"
 void sl_on_modelview3(const sm_mat4* mat) {
 	sl::SubjectMVP3::Instance()->NotifyModelview(sm::mat4(mat->x));
@@ -238,8 +258,99 @@ void sl_flush()
 {
 	Shader* shader = ShaderMgr::Instance()->GetShader();
 	if (shader) {
+		FlushReasonScope scope(FR_FLUSH);
 		shader->Commit();
 	}
+	if (RenderContext* rc = ShaderMgr::Instance()->GetContext()) {
+		rc->FlushDeferred();
+	}
+}
+
+extern "C"
+void sl_set_deferred(int enable) {
+	if (sl::ShaderMgr* mgr = sl::ShaderMgr::Instance()) {
+		if (sl::RenderContext* rc = mgr->GetContext()) {
+			rc->SetDeferred(enable != 0);
+		}
+	}
+}
+
+extern "C"
+void sl_set_sort_layer(int layer) {
+	if (sl::ShaderMgr* mgr = sl::ShaderMgr::Instance()) {
+		if (sl::RenderContext* rc = mgr->GetContext()) {
+			rc->SetSortLayer(layer);
+		}
+	}
+}
+
+extern "C"
+void sl_sort_scope_begin(int reorder) {
+	if (sl::ShaderMgr* mgr = sl::ShaderMgr::Instance()) {
+		if (sl::RenderContext* rc = mgr->GetContext()) {
+			rc->BeginSortScope(reorder != 0);
+		}
+	}
+}
+
+extern "C"
+void sl_sort_scope_end() {
+	if (sl::ShaderMgr* mgr = sl::ShaderMgr::Instance()) {
+		if (sl::RenderContext* rc = mgr->GetContext()) {
+			rc->EndSortScope();
+		}
+	}
+}
+
+extern "C"
+int  sl_static_batch_create() {
+	if (sl::ShaderMgr* mgr = sl::ShaderMgr::Instance()) {
+		if (sl::RenderContext* rc = mgr->GetContext()) {
+			return rc->CreateStaticBatch();
+		}
+	}
+	return -1;
+}
+
+extern "C"
+void sl_static_batch_release(int id) {
+	if (sl::ShaderMgr* mgr = sl::ShaderMgr::Instance()) {
+		if (sl::RenderContext* rc = mgr->GetContext()) {
+			rc->ReleaseStaticBatch(id);
+		}
+	}
+}
+
+extern "C"
+void sl_static_batch_begin(int id) {
+	if (sl::ShaderMgr* mgr = sl::ShaderMgr::Instance()) {
+		if (sl::RenderContext* rc = mgr->GetContext()) {
+			rc->BeginRecord(id);
+		}
+	}
+}
+
+extern "C"
+void sl_static_batch_end() {
+	if (sl::ShaderMgr* mgr = sl::ShaderMgr::Instance()) {
+		if (sl::RenderContext* rc = mgr->GetContext()) {
+			rc->EndRecord();
+		}
+	}
+}
+
+extern "C"
+void sl_static_batch_draw(int id, const sm_mat4* mat) {
+	if (sl::ShaderMgr* mgr = sl::ShaderMgr::Instance()) {
+		if (sl::RenderContext* rc = mgr->GetContext()) {
+			if (mat) {
+				sm::mat4 mv(mat->x);
+				rc->DrawStaticBatch(id, &mv);
+			} else {
+				rc->DrawStaticBatch(id, NULL);
+			}
+		}
+	}
 }
 
 extern "C"
@@ -248,6 +359,41 @@ void sl_dc_count_end()
 	RenderShader::DCCountEnd();
 }
 
+static void copy_draw_stats(const DrawStat& src, struct sl_draw_stats* dst)
+{
+	dst->dc = src.dc;
+	dst->vertices = src.vertices;
+	dst->bytes = src.bytes;
+	for (int i = 0; i < SLFR_MAX_REASON; ++i) {
+		dst->flush[i] = src.flush[i];
+	}
+}
+
+extern "C"
+void sl_get_frame_stats(struct sl_frame_stats* stats)
+{
+	const FrameStat& frame = RenderStat::Instance()->GetFrame();
+	copy_draw_stats(frame.total, &stats->total);
+	for (int i = 0; i < ST_MAX_SHADER; ++i) {
+		copy_draw_stats(frame.shaders[i], &stats->shaders[i]);
+	}
+	FrameArena* arena = FrameArena::Instance();
+	stats->arena_peak = arena->GetPeak();
+	stats->arena_capacity = arena->GetCapacity();
+}
+
+extern "C"
+int  sl_trace_dump(const char* filepath)
+{
+	return Trace::Dump(filepath) ? 1 : 0;
+}
+
+extern "C"
+void sl_trace_clear()
+{
+	Trace::Clear();
+}
+
 /**
  *  @brief
  *    shape2 shader
@@ -370,6 +516,106 @@ void sl_sprite2_draw(const float* positions, const float* texcoords, int texid)
 	}
 }
 
+extern "C"
+void sl_sprite2_draw_batch(int n, const float* positions, const float* texcoords, const int* texids,
+						   const uint32_t* colors, const uint32_t* additives,
+						   const uint32_t* rmaps, const uint32_t* gmaps, const uint32_t* bmaps)
+{
+	ShaderMgr* mgr = ShaderMgr::Instance();
+	if (Sprite2Shader* shader = static_cast<Sprite2Shader*>(mgr->GetShader(SPRITE2))) {
+		shader->DrawBatch(n, positions, texcoords, texids, colors, additives, rmaps, gmaps, bmaps);
+	}
+}
+
+extern "C"
+void sl_sprite2_set_reorder(int reorder)
+{
+	ShaderMgr* mgr = ShaderMgr::Instance();
+	if (Sprite2Shader* shader = static_cast<Sprite2Shader*>(mgr->GetShader(SPRITE2))) {
+		shader->SetReorder(reorder != 0);
+	}
+}
+
+extern "C"
+void sl_sprite2_set_multi_texture(int multi)
+{
+	ShaderMgr* mgr = ShaderMgr::Instance();
+	if (Sprite2Shader* shader = static_cast<Sprite2Shader*>(mgr->GetShader(SPRITE2))) {
+		shader->SetMultiTexture(multi != 0);
+	}
+}
+
+extern "C"
+void sl_sprite2_set_batch_cost(float draw_call, float vertex_byte, const float fragment[4])
+{
+	ShaderMgr* mgr = ShaderMgr::Instance();
+	if (Sprite2Shader* shader = static_cast<Sprite2Shader*>(mgr->GetShader(SPRITE2))) {
+		BatchCost cost;
+		cost.draw_call = draw_call;
+		cost.vertex_byte = vertex_byte;
+		for (int i = 0; i < 4; ++i) {
+			cost.fragment[i] = fragment[i];
+		}
+		shader->SetBatchCost(cost);
+	}
+}
+
+extern "C"
+int  sl_sprite2_pool_create(const float* positions, const float* texcoords, int texid)
+{
+	ShaderMgr* mgr = ShaderMgr::Instance();
+	if (Sprite2Shader* shader = static_cast<Sprite2Shader*>(mgr->GetShader(SPRITE2))) {
+		return shader->CreatePoolSprite(positions, texcoords, texid);
+	}
+	return -1;
+}
+
+extern "C"
+void sl_sprite2_pool_release(int id)
+{
+	ShaderMgr* mgr = ShaderMgr::Instance();
+	if (Sprite2Shader* shader = static_cast<Sprite2Shader*>(mgr->GetShader(SPRITE2))) {
+		shader->GetPool()->Release(id);
+	}
+}
+
+extern "C"
+void sl_sprite2_pool_set_position(int id, const float* positions)
+{
+	ShaderMgr* mgr = ShaderMgr::Instance();
+	if (Sprite2Shader* shader = static_cast<Sprite2Shader*>(mgr->GetShader(SPRITE2))) {
+		shader->GetPool()->SetPosition(id, positions);
+	}
+}
+
+extern "C"
+void sl_sprite2_pool_set_texcoord(int id, const float* texcoords, int texid)
+{
+	ShaderMgr* mgr = ShaderMgr::Instance();
+	if (Sprite2Shader* shader = static_cast<Sprite2Shader*>(mgr->GetShader(SPRITE2))) {
+		shader->GetPool()->SetTexcoord(id, texcoords, texid);
+	}
+}
+
+extern "C"
+void sl_sprite2_pool_set_color(int id, uint32_t color, uint32_t additive, 
+							   uint32_t rmap, uint32_t gmap, uint32_t bmap)
+{
+	ShaderMgr* mgr = ShaderMgr::Instance();
+	if (Sprite2Shader* shader = static_cast<Sprite2Shader*>(mgr->GetShader(SPRITE2))) {
+		shader->GetPool()->SetColor(id, color, additive, rmap, gmap, bmap);
+	}
+}
+
+extern "C"
+void sl_sprite2_pool_draw()
+{
+	ShaderMgr* mgr = ShaderMgr::Instance();
+	if (Sprite2Shader* shader = static_cast<Sprite2Shader*>(mgr->GetShader(SPRITE2))) {
+		shader->GetPool()->Draw();
+	}
+}
+
 /**
  *  @brief
  *    sprite3 shader
@@ -391,14 +637,133 @@ void sl_sprite3_set_map_color(uint32_t rmap, uint32_t gmap, uint32_t bmap) {
 	}
 }
 
+// vertex 3 and 4 repeat 0 and 2, the two triangles are one quad
+static bool sprite3_is_quad(const float* positions, const float* texcoords) {
+	return positions[9] == positions[0] && positions[10] == positions[1] && positions[11] == positions[2]
+		&& positions[12] == positions[6] && positions[13] == positions[7] && positions[14] == positions[8]
+		&& texcoords[6] == texcoords[0] && texcoords[7] == texcoords[1]
+		&& texcoords[8] == texcoords[4] && texcoords[9] == texcoords[5];
+}
+
+// six vertices of two triangles to quads, return 1 or 2.
+// Other triangles become one quad each, (a, b, c, c) drawn as (a, b, c) and
+// a degenerate (a, c, c)
+static int sprite3_to_quads(const float* positions, const float* texcoords, float* quad_pos, float* quad_tex) {
+	static const int QUAD[4] = { 0, 1, 2, 5 };
+	static const int TRIANGLES[8] = { 0, 1, 2, 2, 3, 4, 5, 5 };
+	int n = sprite3_is_quad(positions, texcoords) ? 1 : 2;
+	const int* corners = n == 1 ? QUAD : TRIANGLES;
+	for (int i = 0; i < n * 4; ++i) {
+		const float* p = positions + corners[i] * 3;
+		quad_pos[i * 3]		= p[0];
+		quad_pos[i * 3 + 1] = p[1];
+		quad_pos[i * 3 + 2] = p[2];
+		const float* t = texcoords + corners[i] * 2;
+		quad_tex[i * 2]		= t[0];
+		quad_tex[i * 2 + 1] = t[1];
+	}
+	return n;
+}
+
+// per sprite values to per quad, NULL stays NULL
+static const uint32_t* sprite3_expand(FrameArena* arena, const uint32_t* src, const int* sprites, int n) {
+	if (!src) {
+		return NULL;
+	}
+	uint32_t* dst = (uint32_t*)arena->Alloc(sizeof(uint32_t) * n);
+	for (int i = 0; i < n; ++i) {
+		dst[i] = src[sprites[i]];
+	}
+	return dst;
+}
+
 extern "C"
 void sl_sprite3_draw(const float* positions, const float* texcoords, int texid) {
+	float quad_pos[24], quad_tex[16];
+	int n = sprite3_to_quads(positions, texcoords, quad_pos, quad_tex);
+	for (int i = 0; i < n; ++i) {
+		sl_sprite3_draw_quad(quad_pos + i * 12, quad_tex + i * 8, texid);
+	}
+}
+
+extern "C"
+void sl_sprite3_draw_quad(const float* positions, const float* texcoords, int texid) {
 	ShaderMgr* mgr = ShaderMgr::Instance();
 	if (Sprite3Shader* shader = static_cast<Sprite3Shader*>(mgr->GetShader(SPRITE3))) {
 		shader->Draw(positions, texcoords, texid);
 	}
 }
 
+extern "C"
+void sl_sprite3_draw_batch(int n, const float* positions, const float* texcoords, const int* texids,
+						   const uint32_t* colors, const uint32_t* additives,
+						   const uint32_t* rmaps, const uint32_t* gmaps, const uint32_t* bmaps) {
+	if (n <= 0) {
+		return;
+	}
+
+	FrameArena* arena = FrameArena::Instance();
+	FrameArena::Scope scope(arena);
+	float* quad_pos = (float*)arena->Alloc(sizeof(float) * 24 * n);
+	float* quad_tex = (float*)arena->Alloc(sizeof(float) * 16 * n);
+	// sprite of each quad
+	int* sprites = (int*)arena->Alloc(sizeof(int) * 2 * n);
+	int m = 0;
+	for (int i = 0; i < n; ++i) {
+		int k = sprite3_to_quads(positions + i * 18, texcoords + i * 12, quad_pos + m * 12, quad_tex + m * 8);
+		for (int j = 0; j < k; ++j) {
+			sprites[m++] = i;
+		}
+	}
+	if (m == n) {
+		sl_sprite3_draw_quad_batch(n, quad_pos, quad_tex, texids, colors, additives, rmaps, gmaps, bmaps);
+		return;
+	}
+
+	int* quad_texids = (int*)arena->Alloc(sizeof(int) * m);
+	for (int i = 0; i < m; ++i) {
+		quad_texids[i] = texids[sprites[i]];
+	}
+	sl_sprite3_draw_quad_batch(m, quad_pos, quad_tex, quad_texids,
+		sprite3_expand(arena, colors, sprites, m), sprite3_expand(arena, additives, sprites, m),
+		sprite3_expand(arena, rmaps, sprites, m), sprite3_expand(arena, gmaps, sprites, m),
+		sprite3_expand(arena, bmaps, sprites, m));
+}
+
+extern "C"
+void sl_sprite3_draw_quad_batch(int n, const float* positions, const float* texcoords, const int* texids,
+								const uint32_t* colors, const uint32_t* additives,
+								const uint32_t* rmaps, const uint32_t* gmaps, const uint32_t* bmaps) {
+	ShaderMgr* mgr = ShaderMgr::Instance();
+	if (Sprite3Shader* shader = static_cast<Sprite3Shader*>(mgr->GetShader(SPRITE3))) {
+		shader->DrawBatch(n, positions, texcoords, texids, colors, additives, rmaps, gmaps, bmaps);
+	}
+}
+
+extern "C"
+void sl_sprite3_set_multi_texture(int multi) {
+	ShaderMgr* mgr = ShaderMgr::Instance();
+	if (Sprite3Shader* shader = static_cast<Sprite3Shader*>(mgr->GetShader(SPRITE3))) {
+		shader->SetMultiTexture(multi != 0);
+	}
+}
+
+extern "C"
+void sl_sprite3_set_palette(int palette) {
+	ShaderMgr* mgr = ShaderMgr::Instance();
+	if (Sprite3Shader* shader = static_cast<Sprite3Shader*>(mgr->GetShader(SPRITE3))) {
+		shader->SetPalette(palette != 0);
+	}
+}
+
+extern "C"
+void sl_sprite3_set_transform(const sm_mat4* mat) {
+	ShaderMgr* mgr = ShaderMgr::Instance();
+	if (Sprite3Shader* shader = static_cast<Sprite3Shader*>(mgr->GetShader(SPRITE3))) {
+		shader->SetTransform(sm::mat4(mat->x));
+	}
+}
+
 /**
  *  @brief
  *    filter shader
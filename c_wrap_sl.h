@@ -32,7 +32,13 @@ union sm_mat4;
  *    common
  */
 
+enum SL_RENDER_BACKEND {
+	SLRB_EJOY2D = 0,
+	SLRB_HEADLESS,
+};
+
 int  sl_create(int max_texture);
+int  sl_create_with_backend(int max_texture, enum SL_RENDER_BACKEND backend);
 void sl_release();
 
 void sl_create_shader(enum SHADER_TYPE type);
@@ -44,6 +50,8 @@ int  sl_is_shader(enum SHADER_TYPE type);
 void sl_on_projection2(int w, int h);
 void sl_on_projection3(const union sm_mat4*);
 void sl_on_modelview2(float x, float y, float sx, float sy);
+// apply the 2d modelview to positions on the cpu, so it never breaks batches
+void sl_set_pre_transform2(int enable);
 void sl_on_modelview3(const union sm_mat4*);
 
 void sl_set_texture(int id);
@@ -63,8 +71,78 @@ struct render* sl_get_ej_render();
 
 void sl_flush();
 
+/**
+ *  @brief
+ *    deferred mode: draws are recorded and submitted by sl_flush(),
+ *    sorted by state only inside reorder scopes
+ */
+void sl_set_deferred(int enable);
+void sl_set_sort_layer(int layer);
+void sl_sort_scope_begin(int reorder);
+void sl_sort_scope_end();
+
+/**
+ *  @brief
+ *    static batch: sprite, shape and filter draws between begin and end are
+ *    recorded into the batch instead of drawn, replayed by sl_static_batch_draw()
+ *    with the buffers kept on the device. mat is applied after the recorded 
+ *    modelview for scrolling, can be NULL.
+ */
+int  sl_static_batch_create();
+void sl_static_batch_release(int id);
+void sl_static_batch_begin(int id);
+void sl_static_batch_end();
+void sl_static_batch_draw(int id, const union sm_mat4* mat);
+
 void sl_dc_count_end();
 
+/**
+ *  @note
+ *    the values should same as sl::FLUSH_REASON
+ */
+enum SL_FLUSH_REASON {
+	SLFR_TEXTURE = 0,
+	SLFR_UNIFORM,
+	SLFR_BLEND,
+	SLFR_DRAW_MODE,
+	SLFR_VB_OVERFLOW,
+	SLFR_IB_OVERFLOW,
+	SLFR_SHADER,
+	SLFR_FLUSH,
+	SLFR_OTHER,
+
+	SLFR_MAX_REASON
+};
+
+struct sl_draw_stats {
+	int dc;
+	int vertices;
+	int bytes;
+	int flush[SLFR_MAX_REASON];
+};
+
+struct sl_frame_stats {
+	struct sl_draw_stats total;
+	struct sl_draw_stats shaders[ST_MAX_SHADER];
+	// temporary buffers, high-water mark and capacity in bytes
+	int arena_peak;
+	int arena_capacity;
+};
+
+/**
+ *  @brief
+ *    counters of the last frame closed by sl_dc_count_end()
+ */
+void sl_get_frame_stats(struct sl_frame_stats* stats);
+
+/**
+ *  @brief
+ *    chrome trace of the recent frames, only records with SL_TRACE,
+ *    call from the render thread
+ */
+int  sl_trace_dump(const char* filepath);
+void sl_trace_clear();
+
 /**
  *  @brief
  *    shape2 shader
@@ -91,6 +169,35 @@ void sl_shape3_draw_node(float x, float y, float z, int dummy);
 void sl_sprite2_set_color(uint32_t color, uint32_t additive);
 void sl_sprite2_set_map_color(uint32_t rmap, uint32_t gmap, uint32_t bmap);
 void sl_sprite2_draw(const float* positions, const float* texcoords, int texid);
+/**
+ *  @brief
+ *    n sprites per call, 8 floats of positions and texcoords each,
+ *    the color arrays can be NULL to use the current color
+ */
+void sl_sprite2_draw_batch(int n, const float* positions, const float* texcoords, const int* texids,
+						   const uint32_t* colors, const uint32_t* additives,
+						   const uint32_t* rmaps, const uint32_t* gmaps, const uint32_t* bmaps);
+// merge batches across texture switches when quads don't overlap
+void sl_sprite2_set_reorder(int reorder);
+// flush only when a 9th distinct texture appears
+void sl_sprite2_set_multi_texture(int multi);
+// split a batch rather than upgrade its color program when cheaper, 
+// fragment is per quad for no color, multi add, map and full color
+void sl_sprite2_set_batch_cost(float draw_call, float vertex_byte, const float fragment[4]);
+
+/**
+ *  @brief
+ *    retained sprites kept on the device, created with the current colors
+ *    and changed by handle, only the changed ones are uploaded.
+ *    Grouped by texture and colors, not in painter's order across groups.
+ */
+int  sl_sprite2_pool_create(const float* positions, const float* texcoords, int texid);
+void sl_sprite2_pool_release(int id);
+void sl_sprite2_pool_set_position(int id, const float* positions);
+void sl_sprite2_pool_set_texcoord(int id, const float* texcoords, int texid);
+void sl_sprite2_pool_set_color(int id, uint32_t color, uint32_t additive, 
+							   uint32_t rmap, uint32_t gmap, uint32_t bmap);
+void sl_sprite2_pool_draw();
 
 /**
  *  @brief
@@ -98,7 +205,24 @@ void sl_sprite2_draw(const float* positions, const float* texcoords, int texid);
  */
 void sl_sprite3_set_color(uint32_t color, uint32_t additive);
 void sl_sprite3_set_map_color(uint32_t rmap, uint32_t gmap, uint32_t bmap);
+// two triangles, 18 floats of positions and 12 of texcoords. When vertex 3
+// and 4 repeat 0 and 2 (positions and texcoords) they are drawn as the quad
+// (0,1,2,5), otherwise each triangle takes a quad of its own.
 void sl_sprite3_draw(const float* positions, const float* texcoords, int texid);
+// 4 corners, 12 floats of positions and 8 of texcoords
+void sl_sprite3_draw_quad(const float* positions, const float* texcoords, int texid);
+// 18 floats of positions and 12 of texcoords per sprite, as sl_sprite3_draw
+void sl_sprite3_draw_batch(int n, const float* positions, const float* texcoords, const int* texids,
+						   const uint32_t* colors, const uint32_t* additives,
+						   const uint32_t* rmaps, const uint32_t* gmaps, const uint32_t* bmaps);
+// 12 floats of positions and 8 of texcoords per sprite
+void sl_sprite3_draw_quad_batch(int n, const float* positions, const float* texcoords, const int* texids,
+								const uint32_t* colors, const uint32_t* additives,
+								const uint32_t* rmaps, const uint32_t* gmaps, const uint32_t* bmaps);
+void sl_sprite3_set_multi_texture(int multi);
+// per-vertex model matrix, sprites with different transforms share one draw
+void sl_sprite3_set_palette(int palette);
+void sl_sprite3_set_transform(const union sm_mat4* mat);
 
 /**
  *  @brief
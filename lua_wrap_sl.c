@@ -0,0 +1,1066 @@
+#include "c_wrap_sl.h"
+
+#include <lua.h>
+#include <lauxlib.h>
+
+#include <sm_c_matrix.h>
+
+#include <string.h>
+
+#define SPRITE_BUFFER "shaderlab.sprite_buffer"
+
+/**
+ *  @brief
+ *    sprite buffer
+ *
+ *  @remarks
+ *    fill it from lua with add() / add_rect(), then submit the whole buffer
+ *    with sprite2_draw_batch() or sprite3_draw_batch() in one call.
+ *    color arrays are only passed when a non default color was set.
+ *    3d sprites take 6 vertices of two triangles, or 4 corners when
+ *    created with quad.
+ */
+
+struct sprite_buffer {
+	int dim;
+	int quad;
+	int pos_n, tex_n;
+
+	int cap, n;
+
+	float* positions;
+	float* texcoords;
+	int* texids;
+	uint32_t* colors;
+	uint32_t* additives;
+	uint32_t* rmaps;
+	uint32_t* gmaps;
+	uint32_t* bmaps;
+
+	// state for the next sprites
+	uint32_t color, additive;
+	uint32_t rmap, gmap, bmap;
+
+	int has_color, has_map;
+};
+
+// sprite_buffer(cap, dim, quad)
+static int
+lsprite_buffer(lua_State* L) {
+	int cap = (int)luaL_checkinteger(L, 1);
+	int dim = (int)luaL_optinteger(L, 2, 2);
+	int quad = dim == 2 || lua_toboolean(L, 3);
+	luaL_argcheck(L, cap > 0, 1, "capacity must be positive");
+	luaL_argcheck(L, dim == 2 || dim == 3, 2, "dim should be 2 or 3");
+
+	int pos_n = dim == 2 ? 8 : (quad ? 12 : 18);
+	int tex_n = quad ? 8 : 12;
+	size_t sz = sizeof(struct sprite_buffer)
+		+ sizeof(float) * (pos_n + tex_n) * cap
+		+ sizeof(int) * cap
+		+ sizeof(uint32_t) * 5 * cap;
+	struct sprite_buffer* buf = (struct sprite_buffer*)lua_newuserdata(L, sz);
+	buf->dim = dim;
+	buf->quad = quad;
+	buf->pos_n = pos_n;
+	buf->tex_n = tex_n;
+	buf->cap = cap;
+	buf->n = 0;
+
+	buf->positions = (float*)(buf + 1);
+	buf->texcoords = buf->positions + pos_n * cap;
+	buf->texids = (int*)(buf->texcoords + tex_n * cap);
+	buf->colors = (uint32_t*)(buf->texids + cap);
+	buf->additives = buf->colors + cap;
+	buf->rmaps = buf->additives + cap;
+	buf->gmaps = buf->rmaps + cap;
+	buf->bmaps = buf->gmaps + cap;
+
+	buf->color = 0xffffffff;
+	buf->additive = 0;
+	buf->rmap = 0x000000ff;
+	buf->gmap = 0x0000ff00;
+	buf->bmap = 0x00ff0000;
+	buf->has_color = buf->has_map = 0;
+
+	luaL_setmetatable(L, SPRITE_BUFFER);
+	return 1;
+}
+
+static inline struct sprite_buffer*
+check_sprite_buffer(lua_State* L, int idx) {
+	return (struct sprite_buffer*)luaL_checkudata(L, idx, SPRITE_BUFFER);
+}
+
+static inline void
+push_state(struct sprite_buffer* buf) {
+	int i = buf->n;
+	buf->colors[i] = buf->color;
+	buf->additives[i] = buf->additive;
+	buf->rmaps[i] = buf->rmap;
+	buf->gmaps[i] = buf->gmap;
+	buf->bmaps[i] = buf->bmap;
+}
+
+// buf:add(texid, positions..., texcoords...)
+static int
+lsb_add(lua_State* L) {
+	struct sprite_buffer* buf = check_sprite_buffer(L, 1);
+	if (buf->n >= buf->cap) {
+		return luaL_error(L, "sprite buffer is full (%d)", buf->cap);
+	}
+
+	int i = buf->n;
+	buf->texids[i] = (int)luaL_checkinteger(L, 2);
+	float* pos = buf->positions + i * buf->pos_n;
+	int arg = 3;
+	for (int j = 0; j < buf->pos_n; ++j) {
+		pos[j] = (float)luaL_checknumber(L, arg++);
+	}
+	float* tex = buf->texcoords + i * buf->tex_n;
+	for (int j = 0; j < buf->tex_n; ++j) {
+		tex[j] = (float)luaL_checknumber(L, arg++);
+	}
+	push_state(buf);
+	++buf->n;
+	return 0;
+}
+
+// buf:add_rect(texid, x, y, w, h, u0, v0, u1, v1), only for 2d
+static int
+lsb_add_rect(lua_State* L) {
+	struct sprite_buffer* buf = check_sprite_buffer(L, 1);
+	if (buf->dim != 2) {
+		return luaL_error(L, "add_rect only for 2d sprite buffer");
+	}
+	if (buf->n >= buf->cap) {
+		return luaL_error(L, "sprite buffer is full (%d)", buf->cap);
+	}
+
+	int i = buf->n;
+	buf->texids[i] = (int)luaL_checkinteger(L, 2);
+	float x = (float)luaL_checknumber(L, 3);
+	float y = (float)luaL_checknumber(L, 4);
+	float w = (float)luaL_checknumber(L, 5);
+	float h = (float)luaL_checknumber(L, 6);
+	float u0 = (float)luaL_optnumber(L, 7, 0);
+	float v0 = (float)luaL_optnumber(L, 8, 0);
+	float u1 = (float)luaL_optnumber(L, 9, 1);
+	float v1 = (float)luaL_optnumber(L, 10, 1);
+
+	float* pos = buf->positions + i * 8;
+	pos[0] = x;		pos[1] = y;
+	pos[2] = x;		pos[3] = y + h;
+	pos[4] = x + w;	pos[5] = y + h;
+	pos[6] = x + w;	pos[7] = y;
+
+	float* tex = buf->texcoords + i * 8;
+	tex[0] = u0;	tex[1] = v0;
+	tex[2] = u0;	tex[3] = v1;
+	tex[4] = u1;	tex[5] = v1;
+	tex[6] = u1;	tex[7] = v0;
+
+	push_state(buf);
+	++buf->n;
+	return 0;
+}
+
+static int
+lsb_set_color(lua_State* L) {
+	struct sprite_buffer* buf = check_sprite_buffer(L, 1);
+	buf->color = (uint32_t)luaL_checkinteger(L, 2);
+	buf->additive = (uint32_t)luaL_optinteger(L, 3, 0);
+	if (buf->color != 0xffffffff || (buf->additive & 0xffffff) != 0) {
+		buf->has_color = 1;
+	}
+	return 0;
+}
+
+static int
+lsb_set_map_color(lua_State* L) {
+	struct sprite_buffer* buf = check_sprite_buffer(L, 1);
+	buf->rmap = (uint32_t)luaL_checkinteger(L, 2);
+	buf->gmap = (uint32_t)luaL_checkinteger(L, 3);
+	buf->bmap = (uint32_t)luaL_checkinteger(L, 4);
+	if ((buf->rmap & 0x00ffffff) != 0x000000ff ||
+		(buf->gmap & 0x00ffffff) != 0x0000ff00 ||
+		(buf->bmap & 0x00ffffff) != 0x00ff0000) {
+		buf->has_map = 1;
+	}
+	return 0;
+}
+
+static int
+lsb_clear(lua_State* L) {
+	struct sprite_buffer* buf = check_sprite_buffer(L, 1);
+	buf->n = 0;
+	buf->has_color = buf->color != 0xffffffff || (buf->additive & 0xffffff) != 0;
+	buf->has_map = (buf->rmap & 0x00ffffff) != 0x000000ff
+		|| (buf->gmap & 0x00ffffff) != 0x0000ff00
+		|| (buf->bmap & 0x00ffffff) != 0x00ff0000;
+	return 0;
+}
+
+static int
+lsb_size(lua_State* L) {
+	struct sprite_buffer* buf = check_sprite_buffer(L, 1);
+	lua_pushinteger(L, buf->n);
+	return 1;
+}
+
+static void
+draw_sprite_buffer(lua_State* L, int dim) {
+	struct sprite_buffer* buf = check_sprite_buffer(L, 1);
+	if (buf->dim != dim) {
+		luaL_error(L, "sprite buffer dim %d, need %d", buf->dim, dim);
+		return;
+	}
+	if (buf->n == 0) {
+		return;
+	}
+
+	const uint32_t* colors = buf->has_color ? buf->colors : NULL;
+	const uint32_t* additives = buf->has_color ? buf->additives : NULL;
+	const uint32_t* rmaps = buf->has_map ? buf->rmaps : NULL;
+	const uint32_t* gmaps = buf->has_map ? buf->gmaps : NULL;
+	const uint32_t* bmaps = buf->has_map ? buf->bmaps : NULL;
+	if (dim == 2) {
+		sl_sprite2_draw_batch(buf->n, buf->positions, buf->texcoords, buf->texids,
+			colors, additives, rmaps, gmaps, bmaps);
+	} else if (buf->quad) {
+		sl_sprite3_draw_quad_batch(buf->n, buf->positions, buf->texcoords, buf->texids,
+			colors, additives, rmaps, gmaps, bmaps);
+	} else {
+		sl_sprite3_draw_batch(buf->n, buf->positions, buf->texcoords, buf->texids,
+			colors, additives, rmaps, gmaps, bmaps);
+	}
+
+	if (lua_toboolean(L, 2)) {
+		lsb_clear(L);
+	}
+}
+
+/**
+ *  @brief
+ *    helpers
+ */
+
+static void
+fill_floats(lua_State* L, int idx, float* dst, int n) {
+	for (int i = 0; i < n; ++i) {
+		lua_rawgeti(L, idx, i + 1);
+		dst[i] = (float)lua_tonumber(L, -1);
+		lua_pop(L, 1);
+	}
+}
+
+// all numbers from table at idx, kept in a userdata pushed on the stack
+static float*
+read_floats(lua_State* L, int idx, int* n) {
+	luaL_checktype(L, idx, LUA_TTABLE);
+	*n = (int)lua_rawlen(L, idx);
+	float* dst = (float*)lua_newuserdata(L, sizeof(float) * (*n));
+	fill_floats(L, idx, dst, *n);
+	return dst;
+}
+
+static void
+read_mat4(lua_State* L, int idx, union sm_mat4* mat) {
+	luaL_checktype(L, idx, LUA_TTABLE);
+	if (lua_rawlen(L, idx) < 16) {
+		luaL_error(L, "need 16 numbers for mat4");
+	}
+	fill_floats(L, idx, mat->x, 16);
+}
+
+/**
+ *  @brief
+ *    common
+ */
+
+static int
+lcreate(lua_State* L) {
+	int max_texture = (int)luaL_checkinteger(L, 1);
+	int backend = (int)luaL_optinteger(L, 2, SLRB_EJOY2D);
+	lua_pushinteger(L, sl_create_with_backend(max_texture, (enum SL_RENDER_BACKEND)backend));
+	return 1;
+}
+
+static int
+lrelease(lua_State* L) {
+	sl_release();
+	return 0;
+}
+
+static int
+lcreate_shader(lua_State* L) {
+	sl_create_shader((enum SHADER_TYPE)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+static int
+lrelease_shader(lua_State* L) {
+	sl_release_shader((enum SHADER_TYPE)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+static int
+lset_shader(lua_State* L) {
+	sl_set_shader((enum SHADER_TYPE)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+static int
+lis_shader(lua_State* L) {
+	lua_pushboolean(L, sl_is_shader((enum SHADER_TYPE)luaL_checkinteger(L, 1)));
+	return 1;
+}
+
+static int
+lon_projection2(lua_State* L) {
+	sl_on_projection2((int)luaL_checkinteger(L, 1), (int)luaL_checkinteger(L, 2));
+	return 0;
+}
+
+static int
+lon_projection3(lua_State* L) {
+	union sm_mat4 mat;
+	read_mat4(L, 1, &mat);
+	sl_on_projection3(&mat);
+	return 0;
+}
+
+static int
+lon_modelview2(lua_State* L) {
+	float x = (float)luaL_checknumber(L, 1);
+	float y = (float)luaL_checknumber(L, 2);
+	float sx = (float)luaL_optnumber(L, 3, 1);
+	float sy = (float)luaL_optnumber(L, 4, 1);
+	sl_on_modelview2(x, y, sx, sy);
+	return 0;
+}
+
+static int
+lset_pre_transform2(lua_State* L) {
+	sl_set_pre_transform2(lua_toboolean(L, 1));
+	return 0;
+}
+
+static int
+lon_modelview3(lua_State* L) {
+	union sm_mat4 mat;
+	read_mat4(L, 1, &mat);
+	sl_on_modelview3(&mat);
+	return 0;
+}
+
+static int
+lset_texture(lua_State* L) {
+	sl_set_texture((int)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+static int
+lget_texture(lua_State* L) {
+	lua_pushinteger(L, sl_get_texture());
+	return 1;
+}
+
+static int
+lset_target(lua_State* L) {
+	sl_set_target((int)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+static int
+lget_target(lua_State* L) {
+	lua_pushinteger(L, sl_get_target());
+	return 1;
+}
+
+static int
+lset_blend(lua_State* L) {
+	sl_set_blend((int)luaL_checkinteger(L, 1), (int)luaL_checkinteger(L, 2));
+	return 0;
+}
+
+static int
+lset_default_blend(lua_State* L) {
+	sl_set_default_blend();
+	return 0;
+}
+
+static int
+lset_blend_equation(lua_State* L) {
+	sl_set_blend_equation((int)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+static int
+lrender_clear(lua_State* L) {
+	sl_render_clear((unsigned long)luaL_optinteger(L, 1, 0));
+	return 0;
+}
+
+static int
+lrender_version(lua_State* L) {
+	lua_pushinteger(L, sl_render_version());
+	return 1;
+}
+
+static int
+lenable_scissor(lua_State* L) {
+	sl_enable_scissor(lua_toboolean(L, 1));
+	return 0;
+}
+
+static int
+lflush(lua_State* L) {
+	sl_flush();
+	return 0;
+}
+
+static int
+lset_deferred(lua_State* L) {
+	sl_set_deferred(lua_toboolean(L, 1));
+	return 0;
+}
+
+static int
+lset_sort_layer(lua_State* L) {
+	sl_set_sort_layer((int)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+static int
+lsort_scope_begin(lua_State* L) {
+	sl_sort_scope_begin(lua_toboolean(L, 1));
+	return 0;
+}
+
+static int
+lsort_scope_end(lua_State* L) {
+	sl_sort_scope_end();
+	return 0;
+}
+
+static int
+lstatic_batch_create(lua_State* L) {
+	lua_pushinteger(L, sl_static_batch_create());
+	return 1;
+}
+
+static int
+lstatic_batch_release(lua_State* L) {
+	sl_static_batch_release((int)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+static int
+lstatic_batch_begin(lua_State* L) {
+	sl_static_batch_begin((int)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+static int
+lstatic_batch_end(lua_State* L) {
+	sl_static_batch_end();
+	return 0;
+}
+
+static int
+lstatic_batch_draw(lua_State* L) {
+	int id = (int)luaL_checkinteger(L, 1);
+	if (lua_isnoneornil(L, 2)) {
+		sl_static_batch_draw(id, NULL);
+	} else {
+		union sm_mat4 mat;
+		read_mat4(L, 2, &mat);
+		sl_static_batch_draw(id, &mat);
+	}
+	return 0;
+}
+
+static int
+ldc_count_end(lua_State* L) {
+	sl_dc_count_end();
+	return 0;
+}
+
+static void
+push_draw_stats(lua_State* L, const struct sl_draw_stats* stats) {
+	lua_createtable(L, 0, 4);
+	lua_pushinteger(L, stats->dc);
+	lua_setfield(L, -2, "dc");
+	lua_pushinteger(L, stats->vertices);
+	lua_setfield(L, -2, "vertices");
+	lua_pushinteger(L, stats->bytes);
+	lua_setfield(L, -2, "bytes");
+	lua_createtable(L, SLFR_MAX_REASON, 0);
+	for (int i = 0; i < SLFR_MAX_REASON; ++i) {
+		lua_pushinteger(L, stats->flush[i]);
+		lua_rawseti(L, -2, i);
+	}
+	lua_setfield(L, -2, "flush");
+}
+
+// { total = stats, shaders = { [SHADER_TYPE] = stats }, arena_peak, arena_capacity }
+static int
+lget_frame_stats(lua_State* L) {
+	struct sl_frame_stats stats;
+	sl_get_frame_stats(&stats);
+	lua_createtable(L, 0, 4);
+	push_draw_stats(L, &stats.total);
+	lua_setfield(L, -2, "total");
+	lua_createtable(L, ST_MAX_SHADER, 0);
+	for (int i = 0; i < ST_MAX_SHADER; ++i) {
+		push_draw_stats(L, &stats.shaders[i]);
+		lua_rawseti(L, -2, i);
+	}
+	lua_setfield(L, -2, "shaders");
+	lua_pushinteger(L, stats.arena_peak);
+	lua_setfield(L, -2, "arena_peak");
+	lua_pushinteger(L, stats.arena_capacity);
+	lua_setfield(L, -2, "arena_capacity");
+	return 1;
+}
+
+static int
+ltrace_dump(lua_State* L) {
+	lua_pushboolean(L, sl_trace_dump(luaL_checkstring(L, 1)));
+	return 1;
+}
+
+static int
+ltrace_clear(lua_State* L) {
+	sl_trace_clear();
+	return 0;
+}
+
+/**
+ *  @brief
+ *    shape2 & shape3 shader
+ */
+
+static int
+lshape2_color(lua_State* L) {
+	sl_shape2_color((uint32_t)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+static int
+lshape2_type(lua_State* L) {
+	sl_shape2_type((int)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+// shape2_draw({ x0, y0, x1, y1, ... })
+static int
+lshape2_draw(lua_State* L) {
+	int n;
+	float* positions = read_floats(L, 1, &n);
+	sl_shape2_draw(positions, n / 2);
+	return 0;
+}
+
+// shape2_draw_with_color({ x0, y0, ... }, { color0, ... })
+static int
+lshape2_draw_with_color(lua_State* L) {
+	int n;
+	float* positions = read_floats(L, 1, &n);
+	n /= 2;
+	luaL_checktype(L, 2, LUA_TTABLE);
+	uint32_t* colors = (uint32_t*)lua_newuserdata(L, sizeof(uint32_t) * n);
+	for (int i = 0; i < n; ++i) {
+		lua_rawgeti(L, 2, i + 1);
+		colors[i] = (uint32_t)lua_tointeger(L, -1);
+		lua_pop(L, 1);
+	}
+	sl_shape2_draw_with_color(positions, colors, n);
+	return 0;
+}
+
+static int
+lshape2_draw_node(lua_State* L) {
+	sl_shape2_draw_node((float)luaL_checknumber(L, 1), (float)luaL_checknumber(L, 2),
+		(int)luaL_optinteger(L, 3, 0));
+	return 0;
+}
+
+static int
+lshape3_color(lua_State* L) {
+	sl_shape3_color((uint32_t)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+static int
+lshape3_type(lua_State* L) {
+	sl_shape3_type((int)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+// shape3_draw({ x0, y0, z0, x1, y1, z1, ... })
+static int
+lshape3_draw(lua_State* L) {
+	int n;
+	float* positions = read_floats(L, 1, &n);
+	sl_shape3_draw(positions, n / 3);
+	return 0;
+}
+
+static int
+lshape3_draw_node(lua_State* L) {
+	sl_shape3_draw_node((float)luaL_checknumber(L, 1), (float)luaL_checknumber(L, 2),
+		(float)luaL_checknumber(L, 3), (int)luaL_optinteger(L, 4, 0));
+	return 0;
+}
+
+/**
+ *  @brief
+ *    sprite2 & sprite3 shader
+ */
+
+static int
+lsprite2_set_color(lua_State* L) {
+	sl_sprite2_set_color((uint32_t)luaL_checkinteger(L, 1), (uint32_t)luaL_optinteger(L, 2, 0));
+	return 0;
+}
+
+static int
+lsprite2_set_map_color(lua_State* L) {
+	sl_sprite2_set_map_color((uint32_t)luaL_checkinteger(L, 1),
+		(uint32_t)luaL_checkinteger(L, 2), (uint32_t)luaL_checkinteger(L, 3));
+	return 0;
+}
+
+// sprite2_draw(texid, 8 positions, 8 texcoords)
+static int
+lsprite2_draw(lua_State* L) {
+	float positions[8], texcoords[8];
+	int texid = (int)luaL_checkinteger(L, 1);
+	for (int i = 0; i < 8; ++i) {
+		positions[i] = (float)luaL_checknumber(L, 2 + i);
+	}
+	for (int i = 0; i < 8; ++i) {
+		texcoords[i] = (float)luaL_checknumber(L, 10 + i);
+	}
+	sl_sprite2_draw(positions, texcoords, texid);
+	return 0;
+}
+
+// sprite2_draw_batch(buf, clear)
+static int
+lsprite2_draw_batch(lua_State* L) {
+	draw_sprite_buffer(L, 2);
+	return 0;
+}
+
+static int
+lsprite2_set_reorder(lua_State* L) {
+	sl_sprite2_set_reorder(lua_toboolean(L, 1));
+	return 0;
+}
+
+static int
+lsprite2_set_multi_texture(lua_State* L) {
+	sl_sprite2_set_multi_texture(lua_toboolean(L, 1));
+	return 0;
+}
+
+static int
+lsprite2_set_batch_cost(lua_State* L) {
+	float draw_call = luaL_checknumber(L, 1);
+	float vertex_byte = luaL_checknumber(L, 2);
+	float fragment[4];
+	int i;
+	for (i = 0; i < 4; ++i) {
+		fragment[i] = luaL_checknumber(L, 3 + i);
+	}
+	sl_sprite2_set_batch_cost(draw_call, vertex_byte, fragment);
+	return 0;
+}
+
+// sprite2_pool_create(texid, 8 positions, 8 texcoords)
+static int
+lsprite2_pool_create(lua_State* L) {
+	float positions[8], texcoords[8];
+	int texid = (int)luaL_checkinteger(L, 1);
+	int i;
+	for (i = 0; i < 8; ++i) {
+		positions[i] = (float)luaL_checknumber(L, 2 + i);
+	}
+	for (i = 0; i < 8; ++i) {
+		texcoords[i] = (float)luaL_checknumber(L, 10 + i);
+	}
+	lua_pushinteger(L, sl_sprite2_pool_create(positions, texcoords, texid));
+	return 1;
+}
+
+static int
+lsprite2_pool_release(lua_State* L) {
+	sl_sprite2_pool_release((int)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+// sprite2_pool_set_position(id, 8 positions)
+static int
+lsprite2_pool_set_position(lua_State* L) {
+	float positions[8];
+	int id = (int)luaL_checkinteger(L, 1);
+	int i;
+	for (i = 0; i < 8; ++i) {
+		positions[i] = (float)luaL_checknumber(L, 2 + i);
+	}
+	sl_sprite2_pool_set_position(id, positions);
+	return 0;
+}
+
+// sprite2_pool_set_texcoord(id, texid, 8 texcoords)
+static int
+lsprite2_pool_set_texcoord(lua_State* L) {
+	float texcoords[8];
+	int id = (int)luaL_checkinteger(L, 1);
+	int texid = (int)luaL_checkinteger(L, 2);
+	int i;
+	for (i = 0; i < 8; ++i) {
+		texcoords[i] = (float)luaL_checknumber(L, 3 + i);
+	}
+	sl_sprite2_pool_set_texcoord(id, texcoords, texid);
+	return 0;
+}
+
+static int
+lsprite2_pool_set_color(lua_State* L) {
+	sl_sprite2_pool_set_color((int)luaL_checkinteger(L, 1),
+		(uint32_t)luaL_checkinteger(L, 2), (uint32_t)luaL_optinteger(L, 3, 0),
+		(uint32_t)luaL_optinteger(L, 4, 0x000000ff), (uint32_t)luaL_optinteger(L, 5, 0x0000ff00),
+		(uint32_t)luaL_optinteger(L, 6, 0x00ff0000));
+	return 0;
+}
+
+static int
+lsprite2_pool_draw(lua_State* L) {
+	sl_sprite2_pool_draw();
+	return 0;
+}
+
+static int
+lsprite3_set_color(lua_State* L) {
+	sl_sprite3_set_color((uint32_t)luaL_checkinteger(L, 1), (uint32_t)luaL_optinteger(L, 2, 0));
+	return 0;
+}
+
+static int
+lsprite3_set_map_color(lua_State* L) {
+	sl_sprite3_set_map_color((uint32_t)luaL_checkinteger(L, 1),
+		(uint32_t)luaL_checkinteger(L, 2), (uint32_t)luaL_checkinteger(L, 3));
+	return 0;
+}
+
+// sprite3_draw(texid, 18 positions, 12 texcoords)
+static int
+lsprite3_draw(lua_State* L) {
+	float positions[18], texcoords[12];
+	int texid = (int)luaL_checkinteger(L, 1);
+	for (int i = 0; i < 18; ++i) {
+		positions[i] = (float)luaL_checknumber(L, 2 + i);
+	}
+	for (int i = 0; i < 12; ++i) {
+		texcoords[i] = (float)luaL_checknumber(L, 20 + i);
+	}
+	sl_sprite3_draw(positions, texcoords, texid);
+	return 0;
+}
+
+// sprite3_draw_quad(texid, 12 positions, 8 texcoords), 4 corners
+static int
+lsprite3_draw_quad(lua_State* L) {
+	float positions[12], texcoords[8];
+	int texid = (int)luaL_checkinteger(L, 1);
+	for (int i = 0; i < 12; ++i) {
+		positions[i] = (float)luaL_checknumber(L, 2 + i);
+	}
+	for (int i = 0; i < 8; ++i) {
+		texcoords[i] = (float)luaL_checknumber(L, 14 + i);
+	}
+	sl_sprite3_draw_quad(positions, texcoords, texid);
+	return 0;
+}
+
+// sprite3_draw_batch(buf, clear)
+static int
+lsprite3_draw_batch(lua_State* L) {
+	draw_sprite_buffer(L, 3);
+	return 0;
+}
+
+static int
+lsprite3_set_multi_texture(lua_State* L) {
+	sl_sprite3_set_multi_texture(lua_toboolean(L, 1));
+	return 0;
+}
+
+static int
+lsprite3_set_palette(lua_State* L) {
+	sl_sprite3_set_palette(lua_toboolean(L, 1));
+	return 0;
+}
+
+static int
+lsprite3_set_transform(lua_State* L) {
+	union sm_mat4 mat;
+	read_mat4(L, 1, &mat);
+	sl_sprite3_set_transform(&mat);
+	return 0;
+}
+
+/**
+ *  @brief
+ *    filter shader
+ */
+
+static int
+lfilter_set_mode(lua_State* L) {
+	sl_filter_set_mode((int)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+static int
+lfilter_set_heat_haze_factor(lua_State* L) {
+	sl_filter_set_heat_haze_factor((float)luaL_checknumber(L, 1), (float)luaL_checknumber(L, 2));
+	return 0;
+}
+
+static int
+lfilter_set_heat_haze_texture(lua_State* L) {
+	sl_filter_set_heat_haze_texture((int)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+static int
+lfilter_set_burning_map_upper_texture(lua_State* L) {
+	sl_filter_set_burning_map_upper_texture((int)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+static int
+lfilter_set_burning_map_height_texture(lua_State* L) {
+	sl_filter_set_burning_map_height_texture((int)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+static int
+lfilter_set_burning_map_border_texture(lua_State* L) {
+	sl_filter_set_burning_map_border_texture((int)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+static int
+lfilter_update(lua_State* L) {
+	sl_filter_update((float)luaL_checknumber(L, 1));
+	return 0;
+}
+
+static int
+lfilter_clear_time(lua_State* L) {
+	sl_filter_clear_time();
+	return 0;
+}
+
+static int
+lfilter_set_color(lua_State* L) {
+	sl_filter_set_color((uint32_t)luaL_checkinteger(L, 1), (uint32_t)luaL_optinteger(L, 2, 0));
+	return 0;
+}
+
+// filter_draw(texid, 8 positions, 8 texcoords)
+static int
+lfilter_draw(lua_State* L) {
+	float positions[8], texcoords[8];
+	int texid = (int)luaL_checkinteger(L, 1);
+	for (int i = 0; i < 8; ++i) {
+		positions[i] = (float)luaL_checknumber(L, 2 + i);
+	}
+	for (int i = 0; i < 8; ++i) {
+		texcoords[i] = (float)luaL_checknumber(L, 10 + i);
+	}
+	sl_filter_draw(positions, texcoords, texid);
+	return 0;
+}
+
+/**
+ *  @brief
+ *    blend & mask shader
+ */
+
+static int
+lblend_set_mode(lua_State* L) {
+	sl_blend_set_mode((int)luaL_checkinteger(L, 1));
+	return 0;
+}
+
+static int
+lblend_set_color(lua_State* L) {
+	sl_blend_set_color((uint32_t)luaL_checkinteger(L, 1), (uint32_t)luaL_optinteger(L, 2, 0));
+	return 0;
+}
+
+// blend_draw(tex_blend, tex_base, 8 positions, 8 texcoords_blend, 8 texcoords_base)
+static int
+lblend_draw(lua_State* L) {
+	float positions[8], texcoords_blend[8], texcoords_base[8];
+	int tex_blend = (int)luaL_checkinteger(L, 1);
+	int tex_base = (int)luaL_checkinteger(L, 2);
+	for (int i = 0; i < 8; ++i) {
+		positions[i] = (float)luaL_checknumber(L, 3 + i);
+		texcoords_blend[i] = (float)luaL_checknumber(L, 11 + i);
+		texcoords_base[i] = (float)luaL_checknumber(L, 19 + i);
+	}
+	sl_blend_draw(positions, texcoords_blend, texcoords_base, tex_blend, tex_base);
+	return 0;
+}
+
+// mask_draw(tex, tex_mask, 8 positions, 8 texcoords, 8 texcoords_mask)
+static int
+lmask_draw(lua_State* L) {
+	float positions[8], texcoords[8], texcoords_mask[8];
+	int tex = (int)luaL_checkinteger(L, 1);
+	int tex_mask = (int)luaL_checkinteger(L, 2);
+	for (int i = 0; i < 8; ++i) {
+		positions[i] = (float)luaL_checknumber(L, 3 + i);
+		texcoords[i] = (float)luaL_checknumber(L, 11 + i);
+		texcoords_mask[i] = (float)luaL_checknumber(L, 19 + i);
+	}
+	sl_mask_draw(positions, texcoords, texcoords_mask, tex, tex_mask);
+	return 0;
+}
+
+static void
+set_int(lua_State* L, const char* name, int v) {
+	lua_pushinteger(L, v);
+	lua_setfield(L, -2, name);
+}
+
+int
+luaopen_shaderlab(lua_State* L) {
+	luaL_Reg sb_methods[] = {
+		{ "add", lsb_add },
+		{ "add_rect", lsb_add_rect },
+		{ "set_color", lsb_set_color },
+		{ "set_map_color", lsb_set_map_color },
+		{ "clear", lsb_clear },
+		{ "size", lsb_size },
+		{ NULL, NULL },
+	};
+	luaL_newmetatable(L, SPRITE_BUFFER);
+	luaL_newlib(L, sb_methods);
+	lua_setfield(L, -2, "__index");
+	lua_pushcfunction(L, lsb_size);
+	lua_setfield(L, -2, "__len");
+	lua_pop(L, 1);
+
+	luaL_Reg l[] = {
+		{ "create", lcreate },
+		{ "release", lrelease },
+		{ "create_shader", lcreate_shader },
+		{ "release_shader", lrelease_shader },
+		{ "set_shader", lset_shader },
+		{ "is_shader", lis_shader },
+		{ "on_projection2", lon_projection2 },
+		{ "on_projection3", lon_projection3 },
+		{ "on_modelview2", lon_modelview2 },
+		{ "set_pre_transform2", lset_pre_transform2 },
+		{ "on_modelview3", lon_modelview3 },
+		{ "set_texture", lset_texture },
+		{ "get_texture", lget_texture },
+		{ "set_target", lset_target },
+		{ "get_target", lget_target },
+		{ "set_blend", lset_blend },
+		{ "set_default_blend", lset_default_blend },
+		{ "set_blend_equation", lset_blend_equation },
+		{ "render_clear", lrender_clear },
+		{ "render_version", lrender_version },
+		{ "enable_scissor", lenable_scissor },
+		{ "flush", lflush },
+		{ "set_deferred", lset_deferred },
+		{ "set_sort_layer", lset_sort_layer },
+		{ "sort_scope_begin", lsort_scope_begin },
+		{ "sort_scope_end", lsort_scope_end },
+		{ "static_batch_create", lstatic_batch_create },
+		{ "static_batch_release", lstatic_batch_release },
+		{ "static_batch_begin", lstatic_batch_begin },
+		{ "static_batch_end", lstatic_batch_end },
+		{ "static_batch_draw", lstatic_batch_draw },
+		{ "dc_count_end", ldc_count_end },
+		{ "get_frame_stats", lget_frame_stats },
+		{ "trace_dump", ltrace_dump },
+		{ "trace_clear", ltrace_clear },
+
+		{ "shape2_color", lshape2_color },
+		{ "shape2_type", lshape2_type },
+		{ "shape2_draw", lshape2_draw },
+		{ "shape2_draw_with_color", lshape2_draw_with_color },
+		{ "shape2_draw_node", lshape2_draw_node },
+		{ "shape3_color", lshape3_color },
+		{ "shape3_type", lshape3_type },
+		{ "shape3_draw", lshape3_draw },
+		{ "shape3_draw_node", lshape3_draw_node },
+
+		{ "sprite_buffer", lsprite_buffer },
+		{ "sprite2_set_color", lsprite2_set_color },
+		{ "sprite2_set_map_color", lsprite2_set_map_color },
+		{ "sprite2_draw", lsprite2_draw },
+		{ "sprite2_draw_batch", lsprite2_draw_batch },
+		{ "sprite2_set_reorder", lsprite2_set_reorder },
+		{ "sprite2_set_multi_texture", lsprite2_set_multi_texture },
+		{ "sprite2_set_batch_cost", lsprite2_set_batch_cost },
+		{ "sprite2_pool_create", lsprite2_pool_create },
+		{ "sprite2_pool_release", lsprite2_pool_release },
+		{ "sprite2_pool_set_position", lsprite2_pool_set_position },
+		{ "sprite2_pool_set_texcoord", lsprite2_pool_set_texcoord },
+		{ "sprite2_pool_set_color", lsprite2_pool_set_color },
+		{ "sprite2_pool_draw", lsprite2_pool_draw },
+		{ "sprite3_set_color", lsprite3_set_color },
+		{ "sprite3_set_map_color", lsprite3_set_map_color },
+		{ "sprite3_draw", lsprite3_draw },
+		{ "sprite3_draw_quad", lsprite3_draw_quad },
+		{ "sprite3_draw_batch", lsprite3_draw_batch },
+		{ "sprite3_set_multi_texture", lsprite3_set_multi_texture },
+		{ "sprite3_set_palette", lsprite3_set_palette },
+		{ "sprite3_set_transform", lsprite3_set_transform },
+
+		{ "filter_set_mode", lfilter_set_mode },
+		{ "filter_set_heat_haze_factor", lfilter_set_heat_haze_factor },
+		{ "filter_set_heat_haze_texture", lfilter_set_heat_haze_texture },
+		{ "filter_set_burning_map_upper_texture", lfilter_set_burning_map_upper_texture },
+		{ "filter_set_burning_map_height_texture", lfilter_set_burning_map_height_texture },
+		{ "filter_set_burning_map_border_texture", lfilter_set_burning_map_border_texture },
+		{ "filter_update", lfilter_update },
+		{ "filter_clear_time", lfilter_clear_time },
+		{ "filter_set_color", lfilter_set_color },
+		{ "filter_draw", lfilter_draw },
+
+		{ "blend_set_mode", lblend_set_mode },
+		{ "blend_set_color", lblend_set_color },
+		{ "blend_draw", lblend_draw },
+
+		{ "mask_draw", lmask_draw },
+
+		{ NULL, NULL },
+	};
+	luaL_newlib(L, l);
+
+	set_int(L, "SHAPE2", ST_SHAPE2);
+	set_int(L, "SHAPE3", ST_SHAPE3);
+	set_int(L, "SPRITE2", ST_SPRITE2);
+	set_int(L, "SPRITE3", ST_SPRITE3);
+	set_int(L, "BLEND", ST_BLEND);
+	set_int(L, "FILTER", ST_FILTER);
+	set_int(L, "MODEL3", ST_MODEL3);
+	set_int(L, "MASK", ST_MASK);
+
+	set_int(L, "BACKEND_EJOY2D", SLRB_EJOY2D);
+	set_int(L, "BACKEND_HEADLESS", SLRB_HEADLESS);
+
+	return 1;
+}
\ No newline at end of file
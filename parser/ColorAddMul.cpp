@@ -1,6 +1,7 @@
 #include "ColorAddMul.h"
 #include "Attribute.h"
 #include "Varying.h"
+#include "Uniform.h"
 #include "StringHelper.h"
 
 namespace sl
@@ -8,8 +9,15 @@ namespace sl
 namespace parser
 {
 
-ColorAddMul::ColorAddMul()
+ColorAddMul::ColorAddMul(bool uniform)
+	: m_uniform(uniform)
 {
+	if (m_uniform) {
+		m_uniforms.push_back(new Uniform(VT_FLOAT4, "color"));
+		m_uniforms.push_back(new Uniform(VT_FLOAT4, "additive"));
+		return;
+	}
+
 	m_attributes.push_back(new Attribute(VT_FLOAT4, "color"));
 	m_attributes.push_back(new Attribute(VT_FLOAT4, "additive"));
 
@@ -31,6 +39,9 @@ std::string& ColorAddMul::ToStatements(std::string& str) const
 		_col_add_multi_.w = _TMP_.w;\n \
 		_col_add_multi_ *= v_color.w;\n \
 		_col_add_multi_.xyz += v_additive.xyz * _TMP_.w * v_color.w;\n ";
+	if (m_uniform) {
+		StringHelper::ReplaceAll(s, "v_", "u_");
+	}
 	StringHelper::ReplaceAll(s, "_TMP_", m_input->GetOutput().GetName());
 	str += s;
 	return str;
@@ -15,18 +15,22 @@ namespace parser
  *  @remarks
  *    input: varying vec4 v_color;
  *           varying vec4 v_additive;
+ *           or uniform u_color and u_additive if batch constant
  *    
  *    output: gl_Position
  */
 class ColorAddMul : public Node
 {
 public:
-	ColorAddMul();
+	ColorAddMul(bool uniform = false);
 
 	virtual std::string& ToStatements(std::string& str) const;
 	
 	virtual Variable GetOutput() const;
 
+private:
+	bool m_uniform;
+
 }; // ColorAddMul
 
 }
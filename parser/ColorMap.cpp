@@ -1,6 +1,7 @@
 #include "ColorMap.h"
 #include "Attribute.h"
 #include "Varying.h"
+#include "Uniform.h"
 #include "StringHelper.h"
 
 namespace sl
@@ -10,8 +11,16 @@ namespace parser
 
 static const char* OUTPUT_NAME = "_col_map_";
 
-ColorMap::ColorMap()
+ColorMap::ColorMap(bool uniform)
+	: m_uniform(uniform)
 {
+	if (m_uniform) {
+		m_uniforms.push_back(new Uniform(VT_FLOAT4, "rmap"));
+		m_uniforms.push_back(new Uniform(VT_FLOAT4, "gmap"));
+		m_uniforms.push_back(new Uniform(VT_FLOAT4, "bmap"));
+		return;
+	}
+
 	m_attributes.push_back(new Attribute(VT_FLOAT4, "rmap"));
 	m_attributes.push_back(new Attribute(VT_FLOAT4, "gmap"));
 	m_attributes.push_back(new Attribute(VT_FLOAT4, "bmap"));
@@ -56,6 +65,9 @@ std::string& ColorMap::ToStatements(std::string& str) const
 		\
 		vec4 _col_map_ = vec4(dr + dg + db + _TMP_.rgb, _TMP_.a);\n \
 		";
+	if (m_uniform) {
+		StringHelper::ReplaceAll(s, "v_", "u_");
+	}
 	StringHelper::ReplaceAll(s, "_TMP_", m_input->GetOutput().GetName());
 	str += s;
 	return str;
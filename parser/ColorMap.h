@@ -16,19 +16,23 @@ namespace parser
  *    input: varying vec4 v_rmap;
  *           varying vec4 v_gmap;
  *           varying vec4 v_bmap;
+ *           or uniform u_rmap, u_gmap and u_bmap if batch constant
  *    
  *    output: gl_Position
  */
 class ColorMap : public Node
 {
 public:
-	ColorMap();
+	ColorMap(bool uniform = false);
 
 	virtual std::string& GetHeader(std::string& str) const;
 	virtual std::string& ToStatements(std::string& str) const;
 	
 	virtual Variable GetOutput() const;
 
+private:
+	bool m_uniform;
+
 }; // ColorMap
 
 }
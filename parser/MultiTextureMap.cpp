@@ -0,0 +1,49 @@
+#include "MultiTextureMap.h"
+#include "Varying.h"
+#include "Uniform.h"
+
+#include <stdio.h>
+
+namespace sl
+{
+namespace parser
+{
+
+static const char* OUTPUT_NAME = "_tex_map_";
+
+MultiTextureMap::MultiTextureMap(int count)
+	: m_count(count)
+{
+	m_varyings.push_back(new Varying(VT_FLOAT2, "texcoord"));
+	m_varyings.push_back(new Varying(VT_FLOAT1, "tex_slot"));
+
+	for (int i = 0; i < m_count; ++i) {
+		char buf[32];
+		sprintf(buf, "texture%d", i);
+		m_uniforms.push_back(new Uniform(VT_SAMPLER2D, buf));
+	}
+}
+
+std::string& MultiTextureMap::ToStatements(std::string& str) const
+{
+	char buf[128];
+	sprintf(buf, "vec4 %s;\n", OUTPUT_NAME);
+	str += buf;
+	for (int i = 0; i < m_count - 1; ++i) {
+		sprintf(buf, "%sif (v_tex_slot < %d.5) %s = texture2D(u_texture%d, v_texcoord);\n", 
+			i == 0 ? "" : "else ", i, OUTPUT_NAME, i);
+		str += buf;
+	}
+	sprintf(buf, "%s%s = texture2D(u_texture%d, v_texcoord);\n", 
+		m_count > 1 ? "else " : "", OUTPUT_NAME, m_count - 1);
+	str += buf;
+	return str;
+}
+
+Variable MultiTextureMap::GetOutput() const
+{
+	return Variable(VT_FLOAT4, OUTPUT_NAME);
+}
+
+}
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#ifndef _SHADERLAB_PARSER_MULTI_TEXTURE_MAP_H_
+#define _SHADERLAB_PARSER_MULTI_TEXTURE_MAP_H_
+
+#include "Node.h"
+
+namespace sl
+{
+namespace parser
+{
+
+/**
+ *  @brief
+ *    sample one of u_texture0 ~ u_texture[count-1], selected by v_tex_slot
+ *
+ *  @remarks
+ *    glsl es 2.0 can't index samplers dynamically, so it's an if chain.
+ */
+class MultiTextureMap : public Node
+{
+public:
+	MultiTextureMap(int count);
+
+	virtual std::string& ToStatements(std::string& str) const;
+
+	virtual Variable GetOutput() const;
+
+private:
+	int m_count;
+
+};  // MultiTextureMap
+
+}
+}
+
+#endif // _SHADERLAB_PARSER_MULTI_TEXTURE_MAP_H_
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include "PositionTransPalette.h"
+#include "Attribute.h"
+#include "Uniform.h"
+
+#include <stdio.h>
+
+namespace sl
+{
+namespace parser
+{
+
+PositionTransPalette::PositionTransPalette(int count, bool has_modelview)
+	: m_count(count)
+	, m_has_modelview(has_modelview)
+{
+	m_attributes.push_back(new Attribute(VT_FLOAT4, "position"));
+	m_attributes.push_back(new Attribute(VT_FLOAT1, "palette_idx"));
+
+	m_uniforms.push_back(new Uniform(VT_MAT4, "projection"));
+	if (m_has_modelview) {
+		m_uniforms.push_back(new Uniform(VT_MAT4, "modelview"));
+	}
+}
+
+std::string& PositionTransPalette::GetHeader(std::string& str) const
+{
+	// parser::Uniform has no array
+	char buf[64];
+	sprintf(buf, "uniform mat4 u_palette[%d];\n", m_count);
+	str += buf;
+	return str;
+}
+
+std::string& PositionTransPalette::ToStatements(std::string& str) const
+{
+	if (m_has_modelview) {
+		str += "gl_Position = u_projection * u_modelview * u_palette[int(palette_idx)] * position;\n";
+	} else {
+		str += "gl_Position = u_projection * u_palette[int(palette_idx)] * position;\n";
+	}
+	return str;
+}
+
+}
+}
\ No newline at end of file
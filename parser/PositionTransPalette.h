@@ -0,0 +1,43 @@
+#ifndef _SHADERLAB_PARSER_POSITION_TRANS_PALETTE_H_
+#define _SHADERLAB_PARSER_POSITION_TRANS_PALETTE_H_
+
+#include "Node.h"
+
+namespace sl
+{
+namespace parser
+{
+
+/**
+ *  @brief
+ *    vertex position with a per-vertex model matrix
+ *
+ *  @remarks
+ *    input: attribute vec4 position;
+ *           attribute float palette_idx;
+ *           uniform mat4 u_projection;
+ *           uniform mat4 u_modelview;	(only if has_modelview)
+ *           uniform mat4 u_palette[count];
+ *    
+ *    output: gl_Position
+ */
+class PositionTransPalette : public Node
+{
+public:
+	PositionTransPalette(int count, bool has_modelview);
+
+	virtual std::string& GetHeader(std::string& str) const;
+	virtual std::string& ToStatements(std::string& str) const;
+	
+	virtual Variable GetOutput() const { return Variable(VT_FLOAT4, "gl_Position"); }
+
+private:
+	int m_count;
+	bool m_has_modelview;
+
+}; // PositionTransPalette
+
+}
+}
+
+#endif // _SHADERLAB_PARSER_POSITION_TRANS_PALETTE_H_
\ No newline at end of file
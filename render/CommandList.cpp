@@ -0,0 +1,268 @@
+#include "CommandList.h"
+#include "RenderShader.h"
+#include "RenderBuffer.h"
+#include "RenderBackend.h"
+#include "../utility/Trace.h"
+
+#include <render/render.h>
+
+#include <string.h>
+
+namespace sl
+{
+
+CommandList::CommandList()
+	: m_snapshot_count(0)
+{
+}
+
+void CommandList::Add(RenderShader* shader, const State& state, int stat_type)
+{
+	const RenderBuffer* vb = shader->GetVertexBuffer();
+	const RenderBuffer* ib = shader->GetIndexBuffer();
+
+	Command cmd;
+	cmd.shader = shader;
+	cmd.state = state;
+	cmd.mode = shader->GetDrawMode();
+	cmd.stat_type = stat_type;
+	cmd.uniform = AddUniformSnapshot(shader);
+
+	int vb_sz = vb->Size() * vb->Stride();
+	cmd.vb_offset = m_data.size();
+	cmd.vb_n = vb->Size();
+	m_data.insert(m_data.end(), vb->Data(), vb->Data() + vb_sz);
+
+	cmd.ib_offset = m_data.size();
+	cmd.ib_n = 0;
+	if (ib) {
+		int ib_sz = ib->Size() * ib->Stride();
+		cmd.ib_n = ib->Size();
+		m_data.insert(m_data.end(), ib->Data(), ib->Data() + ib_sz);
+	}
+
+	int blend = ((state.blend_src & 0xf) << 4) | (state.blend_dst & 0xf);
+	// all the slots, multi texture batches differ after the first one
+	uint32_t tex = 0;
+	for (int c = 0; c < MAX_TEXTURE_CHANNEL; ++c) {
+		tex = tex * 31 + state.textures[c];
+	}
+	tex ^= tex >> 16;
+	cmd.key = ((uint64_t)(state.target & 0xff) << 56)
+		| ((uint64_t)(state.layer & 0xff) << 48)
+		| ((uint64_t)(shader->GetID() & 0xff) << 40)
+		| ((uint64_t)blend << 32)
+		| ((uint64_t)(tex & 0xffff) << 16)
+		| (uint64_t)(m_snapshot_count & 0xffff);
+
+	m_cmds.push_back(cmd);
+}
+
+void CommandList::BeginScope(bool reorder)
+{
+	EndScope();
+
+	Scope scope;
+	scope.begin = m_cmds.size();
+	scope.end = -1;
+	scope.reorder = reorder;
+	m_scopes.push_back(scope);
+}
+
+void CommandList::EndScope()
+{
+	if (!m_scopes.empty() && m_scopes.back().end == -1) {
+		m_scopes.back().end = m_cmds.size();
+	}
+}
+
+void CommandList::Submit(RenderBackend* backend)
+{
+	SL_TRACE_SCOPE("CommandList::Submit");
+
+	int n = m_cmds.size();
+	m_order.resize(n);
+	for (int i = 0; i < n; ++i) {
+		m_order[i] = i;
+	}
+	for (int i = 0, m = m_scopes.size(); i < m; ++i) {
+		const Scope& s = m_scopes[i];
+		if (s.reorder) {
+			Sort(s.begin, s.end == -1 ? n : s.end);
+		}
+	}
+
+	RenderShader* bound = NULL;
+	State curr;
+	bool curr_valid = false;
+	std::vector<int> applied(m_last_snapshot.size(), -1);
+
+	int i = 0;
+	while (i < n)
+	{
+		const Command& first = m_cmds[m_order[i]];
+		RenderShader* shader = first.shader;
+		int vb_cap = shader->GetVertexBuffer()->Capacity();
+		int ib_cap = shader->GetIndexBuffer() ? shader->GetIndexBuffer()->Capacity() : 0;
+		int stride = shader->GetVertexBuffer()->Stride();
+
+		// merge the run
+		m_vb_buf.clear();
+		m_ib_buf.clear();
+		int vb_n = 0;
+		const Command* prev = NULL;
+		for ( ; i < n; ++i)
+		{
+			const Command& cmd = m_cmds[m_order[i]];
+			if (prev && (!CanMerge(*prev, cmd) || vb_n + cmd.vb_n > vb_cap || 
+				(int)m_ib_buf.size() + cmd.ib_n > ib_cap)) {
+				break;
+			}
+
+			const uint8_t* vb = &m_data[cmd.vb_offset];
+			m_vb_buf.insert(m_vb_buf.end(), vb, vb + cmd.vb_n * stride);
+			const uint16_t* ib = (const uint16_t*)&m_data[cmd.ib_offset];
+			for (int j = 0; j < cmd.ib_n; ++j) {
+				m_ib_buf.push_back(ib[j] + vb_n);
+			}
+			vb_n += cmd.vb_n;
+
+			prev = &cmd;
+		}
+
+		// apply state
+		if (shader != bound) {
+			shader->Bind();
+			bound = shader;
+		}
+		ApplyState(backend, curr_valid ? &curr : NULL, first.state);
+		curr = first.state;
+		curr_valid = true;
+
+		int id = shader->GetID();
+		if (applied[id] != first.uniform) {
+			shader->ApplyUniformValues(&m_uniforms[first.uniform]);
+			applied[id] = first.uniform;
+		}
+
+		shader->Submit(first.mode, &m_vb_buf[0], vb_n, 
+			m_ib_buf.empty() ? NULL : &m_ib_buf[0], m_ib_buf.size(), first.stat_type);
+	}
+
+	Clear();
+}
+
+void CommandList::ApplyState(RenderBackend* backend, const State* prev, const State& s)
+{
+	// negative keeps the bound target
+	if (s.target >= 0 && (!prev || prev->target != s.target)) {
+		backend->Set(TARGET, s.target, 0);
+	}
+	for (int c = 0; c < MAX_TEXTURE_CHANNEL; ++c) {
+		if (prev ? prev->textures[c] != s.textures[c] : s.textures[c] != 0) {
+			backend->Set(TEXTURE, s.textures[c], c);
+		}
+	}
+	if (!prev || prev->blend_src != s.blend_src || prev->blend_dst != s.blend_dst) {
+		backend->SetBlendFunc(s.blend_src, s.blend_dst);
+	}
+	if (!prev || prev->blend_func != s.blend_func) {
+		backend->SetBlendEquation(s.blend_func);
+	}
+	if (!prev || prev->depth != s.depth) {
+		backend->SetDepth(s.depth);
+	}
+}
+
+int CommandList::AddUniformSnapshot(RenderShader* shader)
+{
+	int id = shader->GetID();
+	if (id >= (int)m_last_snapshot.size()) {
+		Snapshot s;
+		s.version = -1;
+		s.offset = 0;
+		m_last_snapshot.resize(id + 1, s);
+	}
+
+	Snapshot& last = m_last_snapshot[id];
+	if (last.version != shader->GetUniformVersion()) {
+		last.version = shader->GetUniformVersion();
+		last.offset = m_uniforms.size();
+		shader->GetUniformValues(m_uniforms);
+		++m_snapshot_count;
+	}
+	return last.offset;
+}
+
+void CommandList::Sort(int begin, int end)
+{
+	int n = end - begin;
+	if (n < 2) {
+		return;
+	}
+
+	// lsd radix sort, stable
+	m_sort_buf.resize(n);
+	int* src = &m_order[begin];
+	int* dst = &m_sort_buf[0];
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		int count[256];
+		memset(count, 0, sizeof(count));
+		for (int i = 0; i < n; ++i) {
+			++count[(m_cmds[src[i]].key >> shift) & 0xff];
+		}
+		// all the same
+		if (count[(m_cmds[src[0]].key >> shift) & 0xff] == n) {
+			continue;
+		}
+
+		int sum = 0;
+		for (int i = 0; i < 256; ++i) {
+			int c = count[i];
+			count[i] = sum;
+			sum += c;
+		}
+		for (int i = 0; i < n; ++i) {
+			dst[count[(m_cmds[src[i]].key >> shift) & 0xff]++] = src[i];
+		}
+
+		int* tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+
+	if (src != &m_order[begin]) {
+		memcpy(&m_order[begin], src, sizeof(int) * n);
+	}
+}
+
+bool CommandList::CanMerge(const Command& prev, const Command& next) const
+{
+	if (prev.shader != next.shader || 
+		prev.uniform != next.uniform ||
+		prev.mode != next.mode ||
+		memcmp(&prev.state, &next.state, sizeof(State)) != 0) {
+		return false;
+	}
+	return next.mode == DRAW_POINTS || next.mode == DRAW_LINES || next.mode == DRAW_TRIANGLES;
+}
+
+void CommandList::Clear()
+{
+	// a scope still open goes on after a flush in the middle of it
+	bool open = !m_scopes.empty() && m_scopes.back().end == -1;
+	bool reorder = open && m_scopes.back().reorder;
+
+	m_cmds.clear();
+	m_scopes.clear();
+	if (open) {
+		BeginScope(reorder);
+	}
+	m_data.clear();
+	m_uniforms.clear();
+	m_snapshot_count = 0;
+	m_last_snapshot.clear();
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+#ifndef _SHADERLAB_COMMAND_LIST_H_
+#define _SHADERLAB_COMMAND_LIST_H_
+
+#include "RenderConst.h"
+#include "../utility/typedef.h"
+
+#include <vector>
+
+#include <stdint.h>
+
+namespace sl
+{
+
+class RenderShader;
+class RenderBackend;
+
+/**
+ *  @brief
+ *    draws recorded in deferred mode, submitted by RenderContext::FlushDeferred()
+ *
+ *  @remarks
+ *    sort key: target | layer | shader | blend | textures | uniform snapshot.
+ *    Only commands inside a reorder scope are sorted (stable), the others keep
+ *    painter's order. Adjacent commands with the same state are merged into 
+ *    one draw call.
+ */
+class CommandList
+{
+public:
+	struct State
+	{
+		int textures[MAX_TEXTURE_CHANNEL];
+		int blend_src, blend_dst, blend_func;
+		int depth;
+		// negative for the bound one
+		int target, layer;
+	};
+
+public:
+	CommandList();
+
+	// stat_type is the shader type for RenderStat
+	void Add(RenderShader* shader, const State& state, int stat_type);
+
+	void BeginScope(bool reorder);
+	void EndScope();
+
+	void Submit(RenderBackend* backend);
+
+	bool IsEmpty() const { return m_cmds.empty(); }
+
+	// only send the differences to prev, all if prev is NULL
+	static void ApplyState(RenderBackend* backend, const State* prev, const State& s);
+
+private:
+	struct Command
+	{
+		uint64_t key;
+
+		RenderShader* shader;
+		State state;
+		DRAW_MODE_TYPE mode;
+		int stat_type;
+
+		// offset in m_uniforms
+		int uniform;
+
+		// offset in m_data, bytes
+		int vb_offset, vb_n;
+		int ib_offset, ib_n;
+	};
+
+	struct Scope
+	{
+		int begin, end;
+		bool reorder;
+	};
+
+	struct Snapshot
+	{
+		int version;
+		int offset;
+	};
+
+private:
+	int AddUniformSnapshot(RenderShader* shader);
+
+	void Sort(int begin, int end);
+
+	bool CanMerge(const Command& prev, const Command& next) const;
+
+	void Clear();
+
+private:
+	std::vector<Command> m_cmds;
+	std::vector<Scope> m_scopes;
+
+	std::vector<uint8_t> m_data;
+	std::vector<float> m_uniforms;
+	int m_snapshot_count;
+
+	// index by RenderShader::GetID()
+	std::vector<Snapshot> m_last_snapshot;
+
+	std::vector<int> m_order, m_sort_buf;
+
+	std::vector<uint8_t> m_vb_buf;
+	std::vector<uint16_t> m_ib_buf;
+
+}; // CommandList
+
+}
+
+#endif // _SHADERLAB_COMMAND_LIST_H_
\ No newline at end of file
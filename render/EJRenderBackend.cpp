@@ -0,0 +1,155 @@
+#include "EJRenderBackend.h"
+#include "RenderConst.h"
+
+#include <render/render.h>
+
+#include <stdlib.h>
+
+namespace sl
+{
+
+EJRenderBackend::EJRenderBackend(int max_texture, int max_shader)
+{
+	struct render_init_args RA;
+	// todo: config these args
+	RA.max_buffer = 128;
+	RA.max_layout = MAX_LAYOUT;
+	RA.max_target = 128;
+	RA.max_texture = max_texture;
+	RA.max_shader = max_shader;
+
+	int smz = render_size(&RA);
+	m_ej_render = (struct render*)malloc(smz);
+	m_ej_render = render_init(&RA, m_ej_render, smz);
+}
+
+EJRenderBackend::~EJRenderBackend()
+{
+	render_exit(m_ej_render);
+	free(m_ej_render);
+}
+
+int EJRenderBackend::GetVersion() const
+{
+	return render_version(m_ej_render);
+}
+
+void EJRenderBackend::Clear(int mask, unsigned long argb)
+{
+	render_clear(m_ej_render, CLEAR_MASK(mask), argb);
+}
+
+void EJRenderBackend::SetViewport(int x, int y, int width, int height)
+{
+	render_setviewport(m_ej_render, x, y, width, height);
+}
+
+void EJRenderBackend::EnableScissor(int enable)
+{
+	render_enablescissor(m_ej_render, enable);
+}
+
+void EJRenderBackend::SetScissor(int x, int y, int width, int height)
+{
+	render_setscissor(m_ej_render, x, y, width, height);
+}
+
+void EJRenderBackend::SetDepth(int depth)
+{
+	render_setdepth(m_ej_render, (DEPTH_FORMAT)depth);
+}
+
+void EJRenderBackend::SetBlendFunc(int src, int dst)
+{
+	render_set_blendfunc(m_ej_render, (BLEND_FORMAT)src, (BLEND_FORMAT)dst);
+}
+
+void EJRenderBackend::SetBlendEquation(int func)
+{
+	render_set_blendeq(m_ej_render, (BLEND_FUNC)func);
+}
+
+RID EJRenderBackend::QueryTarget()
+{
+	return render_query_target();
+}
+
+void EJRenderBackend::ClearTextureCache()
+{
+	render_clear_texture_cache(m_ej_render);
+}
+
+void EJRenderBackend::Set(RENDER_OBJ_TYPE type, RID id, int slot)
+{
+	render_set(m_ej_render, (enum RENDER_OBJ)type, id, slot);
+}
+
+void EJRenderBackend::Release(RENDER_OBJ_TYPE type, RID id)
+{
+	render_release(m_ej_render, (enum RENDER_OBJ)type, id);
+}
+
+RID EJRenderBackend::CreateBuffer(RENDER_OBJ_TYPE type, const void* data, int n, int stride)
+{
+	return render_buffer_create(m_ej_render, (enum RENDER_OBJ)type, data, n, stride);
+}
+
+void EJRenderBackend::UpdateBuffer(RID id, const void* data, int n)
+{
+	render_buffer_update(m_ej_render, id, data, n);
+}
+
+RID EJRenderBackend::CreateVertexLayout(const std::vector<VertexAttrib>& va_list)
+{
+	struct vertex_attrib va[MAX_LAYOUT];
+	int offset = 0;
+	for (int i = 0, n = va_list.size(); i < n; ++i)
+	{
+		const VertexAttrib& src = va_list[i];
+		vertex_attrib& dst = va[i];
+		dst.name = src.name.c_str();
+		dst.vbslot = 0;	// todo
+		dst.n = src.n;
+		dst.size = src.size;
+		dst.offset = offset;
+		offset += src.tot_size;
+	}
+
+	return render_register_vertexlayout(m_ej_render, va_list.size(), va);
+}
+
+RID EJRenderBackend::CreateShader(const char* vs, const char* fs)
+{
+	struct shader_init_args args;
+	args.vs = vs;
+	args.fs = fs;
+	args.texture = 0;
+	return render_shader_create(m_ej_render, &args);
+}
+
+void EJRenderBackend::BindShader(RID id)
+{
+	render_shader_bind(m_ej_render, id);
+}
+
+int EJRenderBackend::GetUniformLocation(const char* name)
+{
+	return render_shader_locuniform(m_ej_render, name);
+}
+
+void EJRenderBackend::SetUniform(int loc, UNIFORM_FORMAT_TYPE t, const float* v)
+{
+	render_shader_setuniform(m_ej_render, loc, (UNIFORM_FORMAT)t, v);
+}
+
+void EJRenderBackend::DrawElements(DRAW_MODE_TYPE mode, int from, int n)
+{
+	render_draw_elements(m_ej_render, (DRAW_MODE)mode, from, n);
+}
+
+void EJRenderBackend::DrawArrays(DRAW_MODE_TYPE mode, int from, int n)
+{
+	render_draw_arrays(m_ej_render, (DRAW_MODE)mode, from, n);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef _SHADERLAB_EJ_RENDER_BACKEND_H_
+#define _SHADERLAB_EJ_RENDER_BACKEND_H_
+
+#include "RenderBackend.h"
+
+namespace sl
+{
+
+/**
+ *  @brief
+ *    forward everything to ejoy2d's render_* functions
+ */
+class EJRenderBackend : public RenderBackend
+{
+public:
+	EJRenderBackend(int max_texture, int max_shader);
+	virtual ~EJRenderBackend();
+
+	virtual int  GetVersion() const;
+
+	virtual void Clear(int mask, unsigned long argb);
+
+	virtual void SetViewport(int x, int y, int width, int height);
+	virtual void EnableScissor(int enable);
+	virtual void SetScissor(int x, int y, int width, int height);
+	virtual void SetDepth(int depth);
+
+	virtual void SetBlendFunc(int src, int dst);
+	virtual void SetBlendEquation(int func);
+
+	virtual RID  QueryTarget();
+	virtual void ClearTextureCache();
+
+	virtual void Set(RENDER_OBJ_TYPE type, RID id, int slot);
+	virtual void Release(RENDER_OBJ_TYPE type, RID id);
+
+	virtual RID  CreateBuffer(RENDER_OBJ_TYPE type, const void* data, int n, int stride);
+	virtual void UpdateBuffer(RID id, const void* data, int n);
+
+	virtual RID  CreateVertexLayout(const std::vector<VertexAttrib>& va_list);
+
+	virtual RID  CreateShader(const char* vs, const char* fs);
+	virtual void BindShader(RID id);
+	virtual int  GetUniformLocation(const char* name);
+	virtual void SetUniform(int loc, UNIFORM_FORMAT_TYPE t, const float* v);
+
+	virtual void DrawElements(DRAW_MODE_TYPE mode, int from, int n);
+	virtual void DrawArrays(DRAW_MODE_TYPE mode, int from, int n);
+
+	virtual render* GetEJRender() { return m_ej_render; }
+
+private:
+	render* m_ej_render;
+
+}; // EJRenderBackend
+
+}
+
+#endif // _SHADERLAB_EJ_RENDER_BACKEND_H_
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include "HeadlessBackend.h"
+#include "RenderShader.h"
+
+#include <string.h>
+
+namespace sl
+{
+
+HeadlessBackend::HeadlessBackend()
+	: m_layout_count(0)
+	, m_shader_count(0)
+	, m_uniform_count(0)
+{
+	// RID 0 is invalid
+	m_buffer_strides.push_back(0);
+
+	Reset();
+}
+
+void HeadlessBackend::Clear(int mask, unsigned long argb)
+{
+	AddRecord(RT_CLEAR, mask, 0, 0);
+}
+
+void HeadlessBackend::SetViewport(int x, int y, int width, int height)
+{
+	AddRecord(RT_STATE, 0, 0, 0);
+}
+
+void HeadlessBackend::EnableScissor(int enable)
+{
+	AddRecord(RT_STATE, 0, 0, 0);
+}
+
+void HeadlessBackend::SetScissor(int x, int y, int width, int height)
+{
+	AddRecord(RT_STATE, 0, 0, 0);
+}
+
+void HeadlessBackend::SetDepth(int depth)
+{
+	AddRecord(RT_STATE, 0, 0, 0);
+}
+
+void HeadlessBackend::SetBlendFunc(int src, int dst)
+{
+	AddRecord(RT_STATE, src, dst, 0);
+}
+
+void HeadlessBackend::SetBlendEquation(int func)
+{
+	AddRecord(RT_STATE, func, 0, 0);
+}
+
+void HeadlessBackend::Set(RENDER_OBJ_TYPE type, RID id, int slot)
+{
+	AddRecord(RT_SET, id, type, 0);
+}
+
+RID HeadlessBackend::CreateBuffer(RENDER_OBJ_TYPE type, const void* data, int n, int stride)
+{
+	RID id = m_buffer_strides.size();
+	m_buffer_strides.push_back(stride);
+	AddRecord(RT_CREATE_BUFFER, id, type, data ? n * stride : 0);
+	return id;
+}
+
+void HeadlessBackend::UpdateBuffer(RID id, const void* data, int n)
+{
+	AddRecord(RT_UPDATE_BUFFER, id, n, n * GetStride(id));
+}
+
+bool HeadlessBackend::UpdateBufferRange(RID id, const void* data, int offset, int n)
+{
+	AddRecord(RT_UPDATE_BUFFER_RANGE, id, n, n * GetStride(id));
+	return true;
+}
+
+void HeadlessBackend::StreamBuffer(RID id, const void* data, int n)
+{
+	AddRecord(RT_STREAM_BUFFER, id, n, n * GetStride(id));
+}
+
+RID HeadlessBackend::CreateVertexLayout(const std::vector<VertexAttrib>& va_list)
+{
+	return ++m_layout_count;
+}
+
+RID HeadlessBackend::CreateShader(const char* vs, const char* fs)
+{
+	return ++m_shader_count;
+}
+
+void HeadlessBackend::BindShader(RID id)
+{
+	AddRecord(RT_BIND_SHADER, id, 0, 0);
+}
+
+int HeadlessBackend::GetUniformLocation(const char* name)
+{
+	return m_uniform_count++;
+}
+
+void HeadlessBackend::SetUniform(int loc, UNIFORM_FORMAT_TYPE t, const float* v)
+{
+	AddRecord(RT_SET_UNIFORM, loc, t, RenderShader::GetUniformSize(t) * sizeof(float));
+}
+
+void HeadlessBackend::DrawElements(DRAW_MODE_TYPE mode, int from, int n)
+{
+	AddRecord(RT_DRAW_ELEMENTS, mode, n, 0);
+}
+
+void HeadlessBackend::DrawArrays(DRAW_MODE_TYPE mode, int from, int n)
+{
+	AddRecord(RT_DRAW_ARRAYS, mode, n, 0);
+}
+
+void HeadlessBackend::Reset()
+{
+	m_records.clear();
+	memset(m_count, 0, sizeof(m_count));
+	memset(m_bytes, 0, sizeof(m_bytes));
+}
+
+void HeadlessBackend::AddRecord(RECORD_TYPE type, int id, int arg, int bytes)
+{
+	Record r;
+	r.type = type;
+	r.id = id;
+	r.arg = arg;
+	r.bytes = bytes;
+	m_records.push_back(r);
+
+	++m_count[type];
+	m_bytes[type] += bytes;
+}
+
+int HeadlessBackend::GetStride(RID id) const
+{
+	return (size_t)id < m_buffer_strides.size() ? m_buffer_strides[id] : 0;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#ifndef _SHADERLAB_HEADLESS_BACKEND_H_
+#define _SHADERLAB_HEADLESS_BACKEND_H_
+
+#include "RenderBackend.h"
+
+#include <vector>
+
+namespace sl
+{
+
+/**
+ *  @brief
+ *    no device, only record every call with its payload size
+ *
+ *  @remarks
+ *    records grow until Reset(), call it once per frame.
+ */
+class HeadlessBackend : public RenderBackend
+{
+public:
+	enum RECORD_TYPE
+	{
+		RT_SET = 0,
+		RT_BIND_SHADER,
+		RT_SET_UNIFORM,
+		RT_CREATE_BUFFER,
+		RT_UPDATE_BUFFER,
+		RT_UPDATE_BUFFER_RANGE,
+		// one for each rotation of a streaming ring
+		RT_STREAM_BUFFER,
+		RT_DRAW_ELEMENTS,
+		RT_DRAW_ARRAYS,
+		RT_CLEAR,
+		RT_STATE,
+
+		RT_MAX_COUNT
+	};
+
+	struct Record
+	{
+		RECORD_TYPE type;
+		int id;
+		int arg;
+		int bytes;
+	};
+
+public:
+	HeadlessBackend();
+
+	virtual int  GetVersion() const { return 2; }
+
+	virtual void Clear(int mask, unsigned long argb);
+
+	virtual void SetViewport(int x, int y, int width, int height);
+	virtual void EnableScissor(int enable);
+	virtual void SetScissor(int x, int y, int width, int height);
+	virtual void SetDepth(int depth);
+
+	virtual void SetBlendFunc(int src, int dst);
+	virtual void SetBlendEquation(int func);
+
+	virtual RID  QueryTarget() { return 0; }
+	virtual void ClearTextureCache() {}
+
+	virtual void Set(RENDER_OBJ_TYPE type, RID id, int slot);
+	virtual void Release(RENDER_OBJ_TYPE type, RID id) {}
+
+	virtual RID  CreateBuffer(RENDER_OBJ_TYPE type, const void* data, int n, int stride);
+	virtual void UpdateBuffer(RID id, const void* data, int n);
+	virtual bool UpdateBufferRange(RID id, const void* data, int offset, int n);
+	virtual void StreamBuffer(RID id, const void* data, int n);
+
+	virtual RID  CreateVertexLayout(const std::vector<VertexAttrib>& va_list);
+
+	virtual RID  CreateShader(const char* vs, const char* fs);
+	virtual void BindShader(RID id);
+	virtual int  GetUniformLocation(const char* name);
+	virtual void SetUniform(int loc, UNIFORM_FORMAT_TYPE t, const float* v);
+
+	virtual void DrawElements(DRAW_MODE_TYPE mode, int from, int n);
+	virtual void DrawArrays(DRAW_MODE_TYPE mode, int from, int n);
+
+	const std::vector<Record>& GetRecords() const { return m_records; }
+	int GetCount(RECORD_TYPE type) const { return m_count[type]; }
+	int GetBytes(RECORD_TYPE type) const { return m_bytes[type]; }
+
+	void Reset();
+
+private:
+	void AddRecord(RECORD_TYPE type, int id, int arg, int bytes);
+
+	// 0 for unknown buffers
+	int GetStride(RID id) const;
+
+private:
+	std::vector<Record> m_records;
+
+	int m_count[RT_MAX_COUNT];
+	int m_bytes[RT_MAX_COUNT];
+
+	// index by RID
+	std::vector<int> m_buffer_strides;
+
+	int m_layout_count;
+	int m_shader_count;
+	int m_uniform_count;
+
+}; // HeadlessBackend
+
+}
+
+#endif // _SHADERLAB_HEADLESS_BACKEND_H_
\ No newline at end of file
@@ -0,0 +1,81 @@
+#ifndef _SHADERLAB_RENDER_BACKEND_H_
+#define _SHADERLAB_RENDER_BACKEND_H_
+
+#include "VertexAttrib.h"
+#include "../utility/typedef.h"
+
+#include <vector>
+
+#include <stddef.h>
+
+struct render;
+
+namespace sl
+{
+
+/**
+ *  @brief
+ *    dispatch table for every device call
+ *
+ *  @remarks
+ *    RenderContext picks one at creation time, RenderShader, RenderBuffer and
+ *    RenderLayout only talk to the device through it.
+ */
+class RenderBackend
+{
+public:
+	virtual ~RenderBackend() {}
+
+	virtual int  GetVersion() const = 0;
+
+	virtual void Clear(int mask, unsigned long argb) = 0;
+
+	virtual void SetViewport(int x, int y, int width, int height) = 0;
+	virtual void EnableScissor(int enable) = 0;
+	virtual void SetScissor(int x, int y, int width, int height) = 0;
+	virtual void SetDepth(int depth) = 0;
+
+	virtual void SetBlendFunc(int src, int dst) = 0;
+	virtual void SetBlendEquation(int func) = 0;
+
+	virtual RID  QueryTarget() = 0;
+	virtual void ClearTextureCache() = 0;
+
+	virtual void Set(RENDER_OBJ_TYPE type, RID id, int slot) = 0;
+	virtual void Release(RENDER_OBJ_TYPE type, RID id) = 0;
+
+	virtual RID  CreateBuffer(RENDER_OBJ_TYPE type, const void* data, int n, int stride) = 0;
+	virtual void UpdateBuffer(RID id, const void* data, int n) = 0;
+	/**
+	 *  @brief
+	 *    overwrite n elements from element offset in the device buffer,
+	 *    data points to the first of them
+	 *  @return
+	 *    false if not supported, the caller uploads the whole buffer
+	 */
+	virtual bool UpdateBufferRange(RID id, const void* data, int offset, int n) { return false; }
+	/**
+	 *  @brief
+	 *    refill a buffer of a streaming ring, the former content is 
+	 *    discarded so the device needn't wait for the draws reading it
+	 */
+	virtual void StreamBuffer(RID id, const void* data, int n) { UpdateBuffer(id, data, n); }
+
+	virtual RID  CreateVertexLayout(const std::vector<VertexAttrib>& va_list) = 0;
+
+	virtual RID  CreateShader(const char* vs, const char* fs) = 0;
+	virtual void BindShader(RID id) = 0;
+	virtual int  GetUniformLocation(const char* name) = 0;
+	virtual void SetUniform(int loc, UNIFORM_FORMAT_TYPE t, const float* v) = 0;
+
+	virtual void DrawElements(DRAW_MODE_TYPE mode, int from, int n) = 0;
+	virtual void DrawArrays(DRAW_MODE_TYPE mode, int from, int n) = 0;
+
+	// only the ejoy2d backend has one
+	virtual render* GetEJRender() { return NULL; }
+
+}; // RenderBackend
+
+}
+
+#endif // _SHADERLAB_RENDER_BACKEND_H_
\ No newline at end of file
@@ -1,25 +1,32 @@
 #include "RenderBuffer.h"
+#include "RenderBackend.h"
+#include "StreamRing.h"
 #include "../utility/Buffer.h"
-
-#include <render/render.h>
+#include "../utility/Trace.h"
 
 namespace sl
 {
 
-RenderBuffer::RenderBuffer(render* ej_render, RENDER_OBJ_TYPE type, int stride, int n, Buffer* buf)
-	: m_ej_render(ej_render)
+RenderBuffer::RenderBuffer(RenderBackend* backend, RENDER_OBJ_TYPE type, int stride, int n, Buffer* buf)
+	: m_backend(backend)
 	, m_type(type)
+	, m_ring(NULL)
 	, m_buf(buf)
+	, m_device_size(0)
 {
-	m_id = render_buffer_create(ej_render, (enum RENDER_OBJ)type, NULL, n, stride);
+	m_id = m_backend->CreateBuffer(type, NULL, n, stride);
 
 	// todo
-//	render_set(m_ej_render, m_type, m_id, 0);
+//	m_backend->Set(m_type, m_id, 0);
 }
 
 RenderBuffer::~RenderBuffer()
 {
-	render_release(m_ej_render, (enum RENDER_OBJ)m_type, m_id);
+	if (m_ring) {
+		m_ring->RemoveReference();
+	} else {
+		m_backend->Release(m_type, m_id);
+	}
 	if (m_buf) {
 		delete m_buf;
 	}
@@ -27,15 +34,54 @@ RenderBuffer::~RenderBuffer()
 
 void RenderBuffer::Bind() 
 {
-	render_set(m_ej_render, (enum RENDER_OBJ)m_type, m_id, 0);
+	m_backend->Set(m_type, m_id, 0);
+}
+
+void RenderBuffer::SetStreaming(StreamRing* ring)
+{
+	if (m_ring || !ring) {
+		return;
+	}
+
+	// the ring's buffers instead of its own
+	m_backend->Release(m_type, m_id);
+	ring->AddReference();
+	m_ring = ring;
+	m_id = m_ring->Next();
 }
 
 void RenderBuffer::Update() 
 {
-	if (m_buf->IsDirty()) {
-		render_buffer_update(m_ej_render, m_id, m_buf->Data(), m_buf->Size());
-		m_buf->ResetDirty();
+	SL_TRACE_SCOPE("RenderBuffer::Update");
+
+	if (!m_buf->IsDirty()) {
+		return;
+	}
+
+	if (m_ring) 
+	{
+		m_id = m_ring->Next();
+		m_backend->Set(m_type, m_id, 0);
+		m_backend->StreamBuffer(m_id, m_buf->Data(), m_buf->Size());
+		// the next upload goes to another device buffer
+		m_buf->ResetDirty(false);
+		return;
+	}
+
+	// ranges inside the device allocation, or reallocate with the whole buffer
+	int n = m_buf->GetDirtyCount();
+	bool partial = m_buf->GetDirty(n - 1).end <= m_device_size;
+	const unsigned char* data = m_buf->Data();
+	int stride = m_buf->Stride();
+	for (int i = 0; partial && i < n; ++i) {
+		const Buffer::Range& r = m_buf->GetDirty(i);
+		partial = m_backend->UpdateBufferRange(m_id, data + r.begin * stride, r.begin, r.end - r.begin);
+	}
+	if (!partial) {
+		m_backend->UpdateBuffer(m_id, data, m_buf->Size());
+		m_device_size = m_buf->Size();
 	}
+	m_buf->ResetDirty();
 }
 
 }
\ No newline at end of file
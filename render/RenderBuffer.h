@@ -6,36 +6,59 @@
 
 #include <CU_RefCountObj.h>
 
-struct render;
-
 namespace sl
 {
 
 class Buffer;
+class RenderBackend;
+class StreamRing;
 
 class RenderBuffer : public cu::RefCountObj
 {
 public:
-	RenderBuffer(render* ej_render, RENDER_OBJ_TYPE type, int stride, int n, Buffer* buf);
+	RenderBuffer(RenderBackend* backend, RENDER_OBJ_TYPE type, int stride, int n, Buffer* buf);
 	virtual ~RenderBuffer();
 
 	void Bind();
 	void Update();
 
+	/**
+	 *  @brief
+	 *    each upload goes to the next device buffer of the ring, 
+	 *    so the draws still reading the former ones are not waited for
+	 */
+	void SetStreaming(StreamRing* ring);
+
 	void Clear() { if (m_buf) { m_buf->Clear(); } }
+	void Truncate(int n) { m_buf->Truncate(n); }
 	int Size() const { return m_buf ? m_buf->Size() : 0; }
 	int Capacity() const { return m_buf ? m_buf->Capacity() : 0; }
+	int Stride() const { return m_buf ? m_buf->Stride() : 0; }
 	bool IsEmpty() const { return m_buf->IsEmpty(); }
 	bool Add(const void* data, int n) { return m_buf->Add(data, n); }
+	void Write(int from, const void* data, int n) { m_buf->Write(from, data, n); }
+
+	template <typename T>
+	T* Map(int n) { return static_cast<T*>(m_buf->Map(n)); }
+
+	void SetStorage(unsigned char* storage) { m_buf->SetStorage(storage); }
+
+	const unsigned char* Data() const { return m_buf ? m_buf->Data() : NULL; }
 
 private:
-	render* m_ej_render;
+	RenderBackend* m_backend;
 
 	RENDER_OBJ_TYPE m_type;
 
 	RID m_id;
 
+	// NULL if not streaming
+	StreamRing* m_ring;
+
 	Buffer* m_buf;
+
+	// elements allocated on the device by the last whole upload
+	int m_device_size;
 	
 }; // RenderBuffer
 
@@ -6,6 +6,12 @@ namespace sl
 
 static const int MAX_LAYOUT = 32;
 
+static const int MAX_TEXTURE_CHANNEL = 8;
+
+// device buffers in turn for the programs' vertices, one ring for each stride
+static const int STREAM_BUFFER_COUNT = 3;
+static const int MAX_STREAM_BUFFER = 4;
+
 }
 
 #endif // _SHADERLAB_RENDER_CONST_H_
\ No newline at end of file
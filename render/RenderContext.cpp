@@ -1,8 +1,15 @@
 #include "RenderContext.h"
 #include "RenderShader.h"
-#include "RenderConst.h"
+#include "RenderBuffer.h"
+#include "RenderLayout.h"
+#include "RenderStat.h"
+#include "RenderBackend.h"
+#include "EJRenderBackend.h"
+#include "StaticBatch.h"
+#include "StreamRing.h"
 #include "../shader/ShaderMgr.h"
 #include "../shader/Shader.h"
+#include "../shader/Utility.h"
 
 #include <render/render.h>
 #include <render/blendmode.h>
@@ -10,59 +17,77 @@
 #include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
-
-// #define DC_LOG
-
-#ifdef DC_LOG
-#include <iostream>
-#endif // _DEBUG
+#include <stdio.h>
 
 namespace sl
 {
 
-RenderContext::RenderContext(int max_texture)
+RenderContext::RenderContext(int max_texture, RenderBackend* backend)
 {
-	struct render_init_args RA;
-	// todo: config these args
-	RA.max_buffer = 128;
-	RA.max_layout = MAX_LAYOUT;
-	RA.max_target = 128;
-	RA.max_texture = max_texture;
-	RA.max_shader = MAX_SHADER;
-
-	int smz = render_size(&RA);
-	m_ej_render = (struct render*)malloc(smz);
-	m_ej_render = render_init(&RA, m_ej_render, smz);
+	if (backend) {
+		m_backend = backend;
+	} else {
+		m_backend = new EJRenderBackend(max_texture, MAX_SHADER);
+	}
 
 	m_shaders.reserve(MAX_SHADER);
 	m_curr = NULL;
 
+	m_quad_index_buf = NULL;
+
 	memset(m_textures, 0, sizeof(m_textures));
 	m_blend_src = BLEND_ONE;
 	m_blend_dst = BLEND_ONE_MINUS_SRC_ALPHA;
-	render_set_blendfunc(m_ej_render, (BLEND_FORMAT)m_blend_src, (BLEND_FORMAT)m_blend_dst);
+	m_backend->SetBlendFunc(m_blend_src, m_blend_dst);
 	m_blend_func = BLEND_FUNC_ADD;
-	render_set_blendeq(m_ej_render, (BLEND_FUNC)m_blend_func);
-	m_target = render_query_target();
+	m_backend->SetBlendEquation(m_blend_func);
+	m_target = m_backend->QueryTarget();
 
 	m_clear_mask = 0;
+
+	m_depth = 0;
+
+	m_deferred = false;
+	m_layer = 0;
+
+	m_record = NULL;
 }
 
 RenderContext::~RenderContext()
 {
+	for (int i = 0, n = m_static_batches.size(); i < n; ++i) {
+		if (m_static_batches[i]) {
+			delete m_static_batches[i];
+		}
+	}
 	for (int i = 0, n = m_shaders.size(); i < n; ++i) {
 		if (m_shaders[i]) {
 			delete m_shaders[i];
 		}
 	}
-	render_exit(m_ej_render);
-	free(m_ej_render);
+	if (m_quad_index_buf) {
+		m_quad_index_buf->RemoveReference();
+	}
+	std::map<std::string, RenderLayout*>::iterator itr = m_layouts.begin();
+	for ( ; itr != m_layouts.end(); ++itr) {
+		itr->second->RemoveReference();
+	}
+	std::map<int, StreamRing*>::iterator itr_ring = m_stream_rings.begin();
+	for ( ; itr_ring != m_stream_rings.end(); ++itr_ring) {
+		itr_ring->second->RemoveReference();
+	}
+	delete m_backend;
+}
+
+render* RenderContext::GetEJRender()
+{
+	return m_backend->GetEJRender();
 }
 
 RenderShader* RenderContext::CreateShader()
 {
 	if (m_shaders.size() < MAX_SHADER) {
-		RenderShader* shader = new RenderShader(m_ej_render);
+		RenderShader* shader = new RenderShader(this, m_shaders.size());
 		m_shaders.push_back(shader);
 		return shader;
 	} else {
@@ -70,17 +95,70 @@ RenderShader* RenderContext::CreateShader()
 	}
 }
 
+RenderBuffer* RenderContext::FetchQuadIndexBuffer(int quad_count)
+{
+	if (!m_quad_index_buf || m_quad_index_buf->Capacity() < quad_count * 6) {
+		// the smaller one stays alive with the shaders using it
+		if (m_quad_index_buf) {
+			m_quad_index_buf->RemoveReference();
+		}
+		m_quad_index_buf = Utility::CreateQuadIndexBuffer(this, quad_count);
+	}
+	m_quad_index_buf->AddReference();
+	return m_quad_index_buf;
+}
+
+RenderLayout* RenderContext::FetchLayout(const std::vector<VertexAttrib>& va_list)
+{
+	std::string key;
+	for (int i = 0, n = va_list.size(); i < n; ++i) {
+		const VertexAttrib& va = va_list[i];
+		char buf[16];
+		sprintf(buf, ":%d:%d;", va.n, va.size);
+		key += va.name;
+		key += buf;
+	}
+
+	RenderLayout* lo = NULL;
+	std::map<std::string, RenderLayout*>::iterator itr = m_layouts.find(key);
+	if (itr != m_layouts.end()) {
+		lo = itr->second;
+	} else {
+		lo = new RenderLayout(m_backend, va_list);
+		m_layouts.insert(std::make_pair(key, lo));
+	}
+	lo->AddReference();
+	return lo;
+}
+
+StreamRing* RenderContext::FetchStreamRing(int stride)
+{
+	StreamRing* ring = NULL;
+	std::map<int, StreamRing*>::iterator itr = m_stream_rings.find(stride);
+	if (itr != m_stream_rings.end()) {
+		ring = itr->second;
+	} else {
+		ring = new StreamRing(m_backend, stride, STREAM_BUFFER_COUNT);
+		m_stream_rings.insert(std::make_pair(stride, ring));
+	}
+	ring->AddReference();
+	return ring;
+}
+
 void RenderContext::SetBlend(int m1, int m2)
 {
 	if (m1 == m_blend_src && m2 == m_blend_dst) {
 		return;
 	}
 
+	FlushReasonScope scope(FR_BLEND);
 	ShaderMgr::Instance()->GetShader()->Commit();
 
 	m_blend_src = m1;
 	m_blend_dst = m2;
-	render_set_blendfunc(m_ej_render, (BLEND_FORMAT)m_blend_src, (BLEND_FORMAT)m_blend_dst);
+	if (!m_deferred) {
+		m_backend->SetBlendFunc(m_blend_src, m_blend_dst);
+	}
 }
 
 void RenderContext::SetBlendEquation(int func)
@@ -89,10 +167,13 @@ void RenderContext::SetBlendEquation(int func)
 		return;
 	}
 
+	FlushReasonScope scope(FR_BLEND);
 	ShaderMgr::Instance()->GetShader()->Commit();
 
 	m_blend_func = func;
-	render_set_blendeq(m_ej_render, (BLEND_FUNC)m_blend_func);
+	if (!m_deferred) {
+		m_backend->SetBlendEquation(m_blend_func);
+	}
 }
 
 void RenderContext::SetDefaultBlend()
@@ -108,14 +189,30 @@ void RenderContext::SetTexture(int id, int channel)
 	}
 
 	if (m_curr) {
-#ifdef DC_LOG
-		std::cout << "DC: SetTexture\n";
-#endif // DC_LOG
+		FlushReasonScope scope(FR_TEXTURE);
 		m_curr->Commit();
 	}
 
 	m_textures[channel] = id;
-	render_set(m_ej_render, TEXTURE, id, channel);
+	if (!m_deferred) {
+		m_backend->Set(TEXTURE, id, channel);
+	}
+}
+
+void RenderContext::SetTarget(int id)
+{
+	if ((RID)id == m_target) {
+		return;
+	}
+
+	// deferred commands take m_target when recorded
+	if (m_deferred) {
+		if (Shader* shader = ShaderMgr::Instance()->GetShader()) {
+			shader->Commit();
+		}
+	}
+	//	render_set(RS->R, TARGET, id, 0);
+	m_target = id;
 }
 
 void RenderContext::BindShader(RenderShader* shader)
@@ -125,14 +222,14 @@ void RenderContext::BindShader(RenderShader* shader)
 	}
 
 	if (m_curr && m_curr->IsUniformChanged()) {
-#ifdef DC_LOG
-		std::cout << "DC: ShaderBind\n";
-#endif // DC_LOG
+		FlushReasonScope scope(FR_SHADER);
 		m_curr->Commit();
 	}
 
 	m_curr = shader;
-	m_curr->Bind();
+	if (!m_deferred) {
+		m_curr->Bind();
+	}
 }
 
 void RenderContext::SetClearFlag(int flag)
@@ -142,32 +239,234 @@ void RenderContext::SetClearFlag(int flag)
 
 void RenderContext::Clear(unsigned long argb)
 {
-	render_clear(m_ej_render, CLEAR_MASK(m_clear_mask), argb);
+	// the recorded draws come before
+	FlushDeferred();
+	m_backend->Clear(m_clear_mask, argb);
 }
 
 int RenderContext::GetShaderVersion() const
 {
-	return render_version(m_ej_render);
+	return m_backend->GetVersion();
 }
 
 void RenderContext::ClearTextureCache()
 {
-	render_clear_texture_cache(m_ej_render);
+	m_backend->ClearTextureCache();
 }
 
 void RenderContext::SetViewport(int x, int y, int width, int height)
 {
-	render_setviewport(m_ej_render, x, y, width, height);
+	FlushDeferred();
+	m_backend->SetViewport(x, y, width, height);
 }
 
 void RenderContext::EnableScissor(int enable)
 {
-	render_enablescissor(m_ej_render, enable);
+	FlushDeferred();
+	m_backend->EnableScissor(enable);
 }
 
 void RenderContext::SetScissor(int x, int y, int width, int height)
 {
-	render_setscissor(m_ej_render, x, y, width, height);
+	FlushDeferred();
+	m_backend->SetScissor(x, y, width, height);
+}
+
+void RenderContext::SetDepth(int depth)
+{
+	// deferred commands take m_depth when recorded
+	if (!m_deferred) {
+		m_backend->SetDepth(depth);
+	}
+	m_depth = depth;
+}
+
+void RenderContext::SetDeferred(bool deferred)
+{
+	if (m_deferred == deferred) {
+		return;
+	}
+
+	if (deferred) {
+		if (Shader* shader = ShaderMgr::Instance()->GetShader()) {
+			FlushReasonScope scope(FR_FLUSH);
+			shader->Commit();
+		}
+		m_deferred = true;
+	} else {
+		FlushDeferred();
+		m_deferred = false;
+		// state changes were not sent while deferred
+		SyncState();
+	}
+}
+
+void RenderContext::SetSortLayer(int layer)
+{
+	if (layer == m_layer) {
+		return;
+	}
+	if (Shader* shader = ShaderMgr::Instance()->GetShader()) {
+		shader->Commit();
+	}
+	m_layer = layer;
+}
+
+void RenderContext::BeginSortScope(bool reorder)
+{
+	if (Shader* shader = ShaderMgr::Instance()->GetShader()) {
+		shader->Commit();
+	}
+	m_cmds.BeginScope(reorder);
+}
+
+void RenderContext::EndSortScope()
+{
+	if (Shader* shader = ShaderMgr::Instance()->GetShader()) {
+		shader->Commit();
+	}
+	m_cmds.EndScope();
+}
+
+void RenderContext::FlushDeferred()
+{
+	if (!m_deferred) {
+		return;
+	}
+
+	if (Shader* shader = ShaderMgr::Instance()->GetShader()) {
+		FlushReasonScope scope(FR_FLUSH);
+		shader->Commit();
+	}
+	if (!m_cmds.IsEmpty()) {
+		FlushReasonScope scope(FR_FLUSH);
+		m_cmds.Submit(m_backend);
+	}
+}
+
+void RenderContext::Defer(RenderShader* shader)
+{
+	CommandList::State state;
+	memcpy(state.textures, m_textures, sizeof(m_textures));
+	state.blend_src = m_blend_src;
+	state.blend_dst = m_blend_dst;
+	state.blend_func = m_blend_func;
+	state.depth = m_depth;
+	state.target = m_target;
+	state.layer = m_layer;
+	int stat_type = ShaderMgr::Instance()->GetShaderType();
+	if (m_record) {
+		// retained draws go to the target bound when they are drawn
+		state.target = -1;
+		m_record->Add(shader, state, stat_type);
+	} else {
+		m_cmds.Add(shader, state, stat_type);
+	}
+}
+
+int RenderContext::CreateStaticBatch()
+{
+	StaticBatch* batch = new StaticBatch;
+	for (int i = 0, n = m_static_batches.size(); i < n; ++i) {
+		if (!m_static_batches[i]) {
+			m_static_batches[i] = batch;
+			return i;
+		}
+	}
+	m_static_batches.push_back(batch);
+	return m_static_batches.size() - 1;
+}
+
+void RenderContext::ReleaseStaticBatch(int id)
+{
+	if (id < 0 || id >= (int)m_static_batches.size() || !m_static_batches[id]) {
+		return;
+	}
+	if (m_record == m_static_batches[id]) {
+		EndRecord();
+	}
+	delete m_static_batches[id];
+	m_static_batches[id] = NULL;
+}
+
+void RenderContext::BeginRecord(int id)
+{
+	if (id < 0 || id >= (int)m_static_batches.size() || !m_static_batches[id]) {
+		return;
+	}
+
+	EndRecord();
+	if (Shader* shader = ShaderMgr::Instance()->GetShader()) {
+		FlushReasonScope scope(FR_FLUSH);
+		shader->Commit();
+	}
+	m_record = m_static_batches[id];
+	m_record->Clear();
+}
+
+void RenderContext::EndRecord()
+{
+	if (!m_record) {
+		return;
+	}
+
+	if (Shader* shader = ShaderMgr::Instance()->GetShader()) {
+		shader->Commit();
+	}
+	m_record->Finish(m_backend);
+	m_record = NULL;
+}
+
+void RenderContext::DrawStaticBatch(int id, const sm::mat4* mv)
+{
+	if (id < 0 || id >= (int)m_static_batches.size() || !m_static_batches[id]) {
+		return;
+	}
+	StaticBatch* batch = m_static_batches[id];
+	if (batch->IsEmpty() || !BeginDirectDraw()) {
+		return;
+	}
+	batch->Draw(m_backend, mv);
+	EndDirectDraw();
+}
+
+bool RenderContext::BeginDirectDraw()
+{
+	if (m_record) {
+		return false;
+	}
+
+	// keep painter's order with the draws before
+	if (Shader* shader = ShaderMgr::Instance()->GetShader()) {
+		FlushReasonScope scope(FR_FLUSH);
+		shader->Commit();
+	}
+	if (m_deferred) {
+		FlushDeferred();
+		SyncState();
+	}
+	return true;
+}
+
+void RenderContext::EndDirectDraw()
+{
+	// the device state was changed around the context
+	SyncState();
+}
+
+void RenderContext::SyncState()
+{
+	for (int i = 0; i < MAX_TEXTURE_CHANNEL; ++i) {
+		if (m_textures[i] != 0) {
+			m_backend->Set(TEXTURE, m_textures[i], i);
+		}
+	}
+	m_backend->SetBlendFunc(m_blend_src, m_blend_dst);
+	m_backend->SetBlendEquation(m_blend_func);
+	m_backend->SetDepth(m_depth);
+	if (m_curr) {
+		m_curr->Bind();
+	}
 }
 
 }
\ No newline at end of file
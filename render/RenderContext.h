@@ -1,9 +1,19 @@
 #ifndef _SHADERLAB_RENDER_CONTEXT_H_
 #define _SHADERLAB_RENDER_CONTEXT_H_
 
+#include "RenderConst.h"
+#include "CommandList.h"
+#include "VertexAttrib.h"
+#include "StagingArena.h"
 #include "../utility/typedef.h"
 
+#include <SM_Matrix.h>
+
 #include <vector>
+#include <map>
+#include <string>
+
+#include <stddef.h>
 
 struct render;
 
@@ -11,27 +21,52 @@ namespace sl
 {
 
 class RenderShader;
+class RenderBackend;
+class RenderBuffer;
+class RenderLayout;
+class StaticBatch;
+class StreamRing;
 
 class RenderContext
 {
 public:
-	RenderContext(int max_texture);
+	/**
+	 *  @param
+	 *    backend	owned by the context, use ejoy2d's render if NULL
+	 */
+	RenderContext(int max_texture, RenderBackend* backend = NULL);
 	~RenderContext();
 
-	render* GetEJRender() { return m_ej_render; }
+	RenderBackend* GetBackend() { return m_backend; }
+	render* GetEJRender();
 
 	RenderShader* CreateShader();
 
+	/**
+	 *  @brief
+	 *    shared resources, the caller gets one reference
+	 *
+	 *  @remarks
+	 *    the quad index buffer is the largest one requested so far,
+	 *    layouts are shared by the same attribute list
+	 */
+	RenderBuffer* FetchQuadIndexBuffer(int quad_count);
+	RenderLayout* FetchLayout(const std::vector<VertexAttrib>& va_list);
+	// shared by the streaming vertex buffers of the same stride
+	StreamRing* FetchStreamRing(int stride);
+
+	// vertex buffers of the programs, one is filled at a time
+	StagingArena* GetVertexArena() { return &m_vertex_arena; }
+	// quads staged by the shaders before packing
+	StagingArena* GetQuadArena() { return &m_quad_arena; }
+
 	void SetBlend(int m1, int m2);
 	void SetBlendEquation(int func);
 	void SetDefaultBlend();
 
 	void SetTexture(int id, int channel);
 	int  GetTexture() const { return m_textures[0]; }
-	void SetTarget(int id) {
-		//	render_set(RS->R, TARGET, id, 0);
-		m_target = id;	
-	}
+	void SetTarget(int id);
 	int  GetTarget() const {
 		//	return render_get(RS->R, TARGET, 0);
 		return m_target;
@@ -51,16 +86,71 @@ public:
 	void EnableScissor(int enable);
 	void SetScissor(int x, int y, int width, int height);
 
+	void SetDepth(int depth);
+
+	/**
+	 *  @brief
+	 *    record draws instead of issuing them, until FlushDeferred()
+	 */
+	void SetDeferred(bool deferred);
+	bool IsDeferred() const { return m_deferred; }
+
+	void SetSortLayer(int layer);
+	void BeginSortScope(bool reorder);
+	void EndSortScope();
+
+	void FlushDeferred();
+
+	// called by RenderShader::Commit() in deferred mode or recording
+	void Defer(RenderShader* shader);
+
+	/**
+	 *  @brief
+	 *    retained draws, recorded once and replayed without packing or 
+	 *    uploading vertices again
+	 */
+	int  CreateStaticBatch();
+	void ReleaseStaticBatch(int id);
+	// draws until EndRecord() go to the batch, the former ones are dropped
+	void BeginRecord(int id);
+	void EndRecord();
+	bool IsRecording() const { return m_record != NULL; }
+	/**
+	 *  @param
+	 *    mv		applied after the recorded modelview, NULL to keep it
+	 *  @note
+	 *    ignored while recording
+	 */
+	void DrawStaticBatch(int id, const sm::mat4* mv);
+
+	/**
+	 *  @brief
+	 *    around drawing retained buffers to the device, flush the pending
+	 *    draws before and restore the device state after
+	 *  @return
+	 *    false while recording, don't draw
+	 */
+	bool BeginDirectDraw();
+	void EndDirectDraw();
+
+private:
+	void SyncState();
+
 private:
-	static const int MAX_TEXTURE_CHANNEL	= 8;
-	static const int MAX_SHADER				= 64;
+	static const int MAX_SHADER = 64;
 
 private:
-	render* m_ej_render;
+	RenderBackend* m_backend;
 
 	std::vector<RenderShader*> m_shaders;
 	RenderShader* m_curr;
 
+	RenderBuffer* m_quad_index_buf;
+	std::map<std::string, RenderLayout*> m_layouts;
+	std::map<int, StreamRing*> m_stream_rings;
+
+	StagingArena m_vertex_arena, m_quad_arena;
+
 	int m_textures[MAX_TEXTURE_CHANNEL];
 	int m_blend_src, m_blend_dst;
 	int m_blend_func;
@@ -68,6 +158,16 @@ private:
 
 	int m_clear_mask;
 
+	int m_depth;
+
+	bool m_deferred;
+	int m_layer;
+	CommandList m_cmds;
+
+	// index by id, NULL for released
+	std::vector<StaticBatch*> m_static_batches;
+	StaticBatch* m_record;
+
 }; // RenderContext
 
 }
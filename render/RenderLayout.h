@@ -8,21 +8,21 @@
 
 #include <vector>
 
-struct render;
-
 namespace sl
 {
 
+class RenderBackend;
+
 class RenderLayout : public cu::RefCountObj
 {
 public:
-	RenderLayout(render* ej_render, const std::vector<VertexAttrib>& va_list);
+	RenderLayout(RenderBackend* backend, const std::vector<VertexAttrib>& va_list);
 	virtual ~RenderLayout();
 
 	void Bind();
 
 private:
-	render* m_ej_render;
+	RenderBackend* m_backend;
 
 	RID m_id;
 
@@ -1,28 +1,33 @@
 #include "RenderShader.h"
+#include "RenderContext.h"
 #include "RenderBuffer.h"
 #include "RenderLayout.h"
+#include "RenderBackend.h"
+#include "RenderStat.h"
+#include "StagingArena.h"
 #include "../shader/ShaderMgr.h"
 #include "../shader/Shader.h"
+#include "../shader/ObserverMVP.h"
+#include "../utility/Trace.h"
+#include "../utility/FrameArena.h"
 
 #include <render/render.h>
 
+#include <algorithm>
+
 // #define SHADER_LOG
 
 #ifdef SHADER_LOG
 #include <iostream>
 #endif // SHADER_LOG
 
-#ifdef SL_DC_STAT
-#include <iostream>
-#endif // SL_DC_STAT
-
 namespace sl
 {
 
-int RenderShader::m_dc_count = 0;
-
-RenderShader::RenderShader(render* ej_render)
-	: m_ej_render(ej_render)
+RenderShader::RenderShader(RenderContext* rc, int id)
+	: m_rc(rc)
+	, m_backend(rc->GetBackend())
+	, m_id(id)
 {
 	m_prog = 0;
 
@@ -30,15 +35,25 @@ RenderShader::RenderShader(render* ej_render)
 
 	m_uniform_number = 0;
 	m_uniform_changed = false;
+	m_uniform_version = 0;
+
+	m_queued = false;
 
 	m_vb = m_ib = NULL;
 	m_layout = NULL;
 
+	m_mvp = NULL;
+
+	m_arena = NULL;
+
 	m_draw_mode = DRAW_POINTS;
 }
 
 RenderShader::~RenderShader()
 {
+	if (m_arena) {
+		m_arena->Release(this);
+	}
 	if (m_vb) m_vb->RemoveReference();
 	if (m_ib) m_ib->RemoveReference();
 	if (m_layout) m_layout->RemoveReference();
@@ -53,19 +68,15 @@ void RenderShader::Load(const char* vs, const char* fs)
 	std::cout << "================================================== \n";
 #endif // SHADER_LOG
 
-	struct shader_init_args args;
-	args.vs = vs;
-	args.fs = fs;
-	args.texture = 0;
-	m_prog = render_shader_create(m_ej_render, &args);
-	render_shader_bind(m_ej_render, m_prog);
-//	render_shader_bind(m_ej_render, 0);	// ??
+	m_prog = m_backend->CreateShader(vs, fs);
+	m_backend->BindShader(m_prog);
+//	m_backend->BindShader(0);	// ??
 	//	S->curr_shader = -1;
 }
 
 void RenderShader::Unload()
 {
-	render_release(m_ej_render, SHADER, m_prog);
+	m_backend->Release(SHADER, m_prog);
 }
 
 void RenderShader::SetVertexBuffer(RenderBuffer* vb) 
@@ -85,7 +96,11 @@ void RenderShader::SetLayout(RenderLayout* lo)
 
 void RenderShader::Bind()
 {
-	render_shader_bind(m_ej_render, m_prog);
+	if (m_mvp) {
+		m_mvp->Update();
+	}
+
+	m_backend->BindShader(m_prog);
 	m_vb->Bind();
 	if (m_ib) {
 		m_ib->Bind();
@@ -95,36 +110,76 @@ void RenderShader::Bind()
 
 void RenderShader::Commit()
 {
+	SL_TRACE_SCOPE("RenderShader::Commit");
+
+	m_queued = false;
+
 	if (!m_vb || m_vb->IsEmpty()) {
 		return;
 	}
 
+	if (m_mvp) {
+		m_mvp->Update();
+	}
+
+	if (m_rc->IsDeferred() || m_rc->IsRecording()) {
+		m_rc->Defer(this);
+		m_vb->Clear();
+		if (m_ib) {
+			m_ib->Clear();
+		}
+		return;
+	}
+
 	ApplyUniform();
-//#ifdef _DEBUG
-//	std::cout << "Commit %d" << m_vb->Size() << "\n";
-//#endif // _DEBUG
+	DrawBuffers(ShaderMgr::Instance()->GetShaderType());
+}
 
-	m_vb->Update();
+void RenderShader::Submit(DRAW_MODE_TYPE mode, const void* vb, int vb_n, const void* ib, int ib_n, int stat_type)
+{
+	BorrowStaging();
+	m_vb->Clear();
+	m_vb->Add(vb, vb_n);
 	if (m_ib) {
-		m_ib->Update();
-		render_draw_elements(m_ej_render, (DRAW_MODE)m_draw_mode, 0, m_ib->Size());
 		m_ib->Clear();
+		m_ib->Add(ib, ib_n);
+	}
+
+	DRAW_MODE_TYPE old = m_draw_mode;
+	m_draw_mode = mode;
+	DrawBuffers(stat_type);
+	m_draw_mode = old;
+}
+
+void RenderShader::DrawRetained(DRAW_MODE_TYPE mode, RenderBuffer* vb, RenderBuffer* ib, int n)
+{
+	vb->Bind();
+	if (ib) {
+		ib->Bind();
+		m_backend->DrawElements(mode, 0, n);
 	} else {
-		render_draw_arrays(m_ej_render, (DRAW_MODE)m_draw_mode, 0, m_vb->Size());
+		m_backend->DrawArrays(mode, 0, n);
 	}
-	m_vb->Clear();
 
-#ifdef SL_DC_STAT
-	++m_dc_count;
-#endif // SL_DC_STAT
+	// back to the staging ones
+	m_vb->Bind();
+	if (m_ib) {
+		m_ib->Bind();
+	}
+}
+
+void RenderShader::ApplyUniforms()
+{
+	if (m_mvp) {
+		m_mvp->Update();
+	}
+	ApplyUniform();
 }
 
 void RenderShader::SetDrawMode(DRAW_MODE_TYPE dm) 
 { 
 	if (m_draw_mode != dm) {
-#ifdef SL_DC_STAT
-		std::cout << "SL DC for set draw mode\n";
-#endif // SL_DC_STAT
+		FlushReasonScope scope(FR_DRAW_MODE);
 		Commit();
 		m_draw_mode = dm;
 	}
@@ -137,13 +192,17 @@ int RenderShader::AddUniform(const char* name, UNIFORM_FORMAT_TYPE t)
 	if (m_uniform_number >= MAX_UNIFORM) {
 		return -1;
 	}
-	int loc = render_shader_locuniform(m_ej_render, name);
+	int loc = m_backend->GetUniformLocation(name);
+	// not declared by the program, don't waste a slot
+	if (loc < 0) {
+		return -1;
+	}
 	int index = m_uniform_number++;
 	m_uniform[index].Assign(loc, t);
-	return loc < 0 ? -1 : index;
+	return index;
 }
 
-void RenderShader::SetUniform(int index, UNIFORM_FORMAT_TYPE t, const float* v)
+void RenderShader::SetUniform(int index, UNIFORM_FORMAT_TYPE t, const float* v, bool flush)
 {
 	// todo RenderContext::Bind()
 
@@ -157,49 +216,239 @@ void RenderShader::SetUniform(int index, UNIFORM_FORMAT_TYPE t, const float* v)
 	}
 
 	m_uniform_changed = true;
-	if (Shader* shader = ShaderMgr::Instance()->GetShader()) {
-#ifdef SL_DC_STAT
-		std::cout << "SL DC for set uniform\n";
-#endif // SL_DC_STAT
-		shader->Commit();
+	// only the draws recorded with the old value need to go out first,
+	// other programs pick the new value up on their next commit
+	if (flush && IsQueued()) {
+		if (Shader* shader = ShaderMgr::Instance()->GetShader()) {
+			FlushReasonScope scope(FR_UNIFORM);
+			shader->Commit();
+		}
 	}
 	m_uniform[index].Assign(t, v);
+	++m_uniform_version;
+}
+
+bool RenderShader::IsQueued() const
+{
+	return m_queued || (m_vb && !m_vb->IsEmpty());
 }
 
 void RenderShader::Draw(void* vb, int vb_n, void* ib, int ib_n)
 {
-	if (m_ib && ib_n > 0 && m_ib->Add(ib, ib_n)) {
-#ifdef SL_DC_STAT
-		std::cout << "ib over\n";
-#endif // SL_DC_STAT
+	if (m_ib && ib_n > 0) {
+		DrawElements(vb, vb_n, ib, ib_n);
+	} else if (m_vb && vb_n > 0) {
+		DrawArrays(static_cast<const uint8_t*>(vb), vb_n);
+	}
+}
+
+void* RenderShader::Map(int vb_n, int ib_n)
+{
+	if (m_ib && m_ib->Size() + ib_n > m_ib->Capacity()) {
+		FlushReasonScope scope(FR_IB_OVERFLOW);
+		Commit();
+	}
+	if (m_vb->Size() + vb_n > m_vb->Capacity()) {
+		FlushReasonScope scope(FR_VB_OVERFLOW);
+		Commit();
+	}
+
+	// before the indices, the former owner may flush with them
+	BorrowStaging();
+	if (m_ib && ib_n > 0) {
+		m_ib->Add(NULL, ib_n);
+	}
+	return m_vb->Map<void>(vb_n);
+}
+
+void RenderShader::DrawElements(const void* vb, int vb_n, const void* ib, int ib_n)
+{
+	if (m_ib->Size() + ib_n > m_ib->Capacity()) {
+		FlushReasonScope scope(FR_IB_OVERFLOW);
+		Commit();
+	}
+	if (m_vb && m_vb->Size() + vb_n > m_vb->Capacity()) {
+		FlushReasonScope scope(FR_VB_OVERFLOW);
+		Commit();
+	}
+
+	// the caller offsets the indices, so each draw must fit the empty buffers
+	assert(ib_n <= m_ib->Capacity() && (!m_vb || vb_n <= m_vb->Capacity()));
+
+	// before the indices, the former owner may flush with them
+	if (m_vb) {
+		BorrowStaging();
+	}
+	m_ib->Add(ib, ib_n);
+	if (m_vb && vb_n > 0) {
+		m_vb->Add(vb, vb_n);
+	}
+}
+
+void RenderShader::DrawArrays(const uint8_t* vb, int n)
+{
+	int cap = m_vb->Capacity();
+	if (m_vb->Size() + n > cap) {
+		FlushReasonScope scope(FR_VB_OVERFLOW);
 		Commit();
 	}
-	if (m_vb && vb_n > 0 && m_vb->Add(vb, vb_n)) {
-#ifdef SL_DC_STAT
-		std::cout << "vb over\n";
-#endif // SL_DC_STAT
+	BorrowStaging();
+	if (n <= cap) {
+		m_vb->Add(vb, n);
+		return;
+	}
+
+	// larger than the buffer, stream it in chunks of whole primitives,
+	// strips and fans repeat the vertices shared with the former chunk
+	int unit = 1, overlap = 0;
+	bool fan = false, loop = false;
+	switch (m_draw_mode)
+	{
+	case DRAW_LINES:
+		unit = 2;
+		break;
+	case DRAW_TRIANGLES:
+		unit = 3;
+		break;
+	case DRAW_LINE_STRIP:
+		overlap = 1;
+		break;
+	case DRAW_LINE_LOOP:
+		overlap = 1;
+		loop = true;
+		break;
+	case DRAW_TRIANGLE_STRIP:
+		// even steps keep the winding
+		unit = overlap = 2;
+		break;
+	case DRAW_TRIANGLE_FAN:
+		overlap = 1;
+		fan = true;
+		break;
+	}
+
+	// a loop is a strip back to the first vertex
+	DRAW_MODE_TYPE mode = m_draw_mode;
+	if (loop) {
+		m_draw_mode = DRAW_LINE_STRIP;
+	}
+
+	int stride = m_vb->Stride();
+	int total = loop ? n + 1 : n;
+	int begin = 0;
+	while (true)
+	{
+		// fans repeat the center
+		int prefix = (fan && begin > 0) ? 1 : 0;
+		int room = cap - prefix;
+		int count = total - begin;
+		bool last = count <= room;
+		if (!last) {
+			count = (room - overlap) / unit * unit + overlap;
+			if (count <= overlap) {
+				break;
+			}
+		}
+
+		uint8_t* dst = m_vb->Map<uint8_t>(prefix + count);
+		if (prefix) {
+			memcpy(dst, vb, stride);
+			dst += stride;
+		}
+		int body = std::min(count, n - begin);
+		memcpy(dst, vb + begin * stride, body * stride);
+		if (count > body) {
+			memcpy(dst + body * stride, vb, stride);
+		}
+
+		if (last) {
+			break;
+		}
+		FlushReasonScope scope(FR_VB_OVERFLOW);
+		Commit();
+		begin += count - overlap;
+	}
+
+	if (loop) {
+		FlushReasonScope scope(FR_DRAW_MODE);
 		Commit();
+		m_draw_mode = mode;
 	}
 }
 
 void RenderShader::DCCountEnd() 
 {
-#ifdef SL_DC_STAT
-	std::cout << "DC count " << m_dc_count << std::endl;
-	m_dc_count = 0;
-#endif // SL_DC_STAT
+	SL_TRACE_MARK("frame");
+	RenderStat::Instance()->EndFrame();
+	FrameArena::Instance()->Reset();
 }
 
 void RenderShader::ApplyUniform()
 {
 	for (int i = 0; i < m_uniform_number; ++i) {
-		bool changed = m_uniform[i].Apply(m_ej_render);
+		bool changed = m_uniform[i].Apply(m_backend);
 		if (changed) {
 			m_uniform_changed = changed;
 		}
 	}
 }
 
+void RenderShader::GetUniformValues(std::vector<float>& dst) const
+{
+	for (int i = 0; i < m_uniform_number; ++i) {
+		const float* v = m_uniform[i].GetValue();
+		dst.insert(dst.end(), v, v + MAX_UNIFORM_SIZE);
+	}
+}
+
+void RenderShader::ApplyUniformValues(const float* src)
+{
+	for (int i = 0; i < m_uniform_number; ++i) {
+		const Uniform& u = m_uniform[i];
+		if (u.GetLocation() >= 0) {
+			m_backend->SetUniform(u.GetLocation(), u.GetType(), src + i * MAX_UNIFORM_SIZE);
+		}
+	}
+}
+
+void RenderShader::DrawBuffers(int stat_type)
+{
+//#ifdef _DEBUG
+//	std::cout << "Commit %d" << m_vb->Size() << "\n";
+//#endif // _DEBUG
+
+	int vb_n = m_vb->Size();
+	int bytes = vb_n * m_vb->Stride();
+
+	m_vb->Update();
+	if (m_ib) {
+		m_ib->Update();
+		m_backend->DrawElements(m_draw_mode, 0, m_ib->Size());
+		m_ib->Clear();
+	} else {
+		m_backend->DrawArrays(m_draw_mode, 0, m_vb->Size());
+	}
+	m_vb->Clear();
+
+	RenderStat::Instance()->AddDrawCall(stat_type, vb_n, bytes);
+}
+
+void RenderShader::BorrowStaging()
+{
+	if (m_arena) {
+		m_vb->SetStorage(m_arena->Borrow(this, &RenderShader::FlushStaging));
+	}
+}
+
+void RenderShader::FlushStaging(void* owner)
+{
+	RenderShader* shader = static_cast<RenderShader*>(owner);
+	if (!shader->m_vb->IsEmpty()) {
+		FlushReasonScope scope(FR_OTHER);
+		shader->Commit();
+	}
+}
+
 int RenderShader::GetUniformSize(UNIFORM_FORMAT_TYPE t)
 {
 	int n = 0;
@@ -270,10 +519,10 @@ void RenderShader::Uniform::Assign(UNIFORM_FORMAT_TYPE t, const float* v)
 	m_changed = true;
 }
 
-bool RenderShader::Uniform::Apply(render* ej_render) 
+bool RenderShader::Uniform::Apply(RenderBackend* backend) 
 {
 	if (m_changed && m_loc >= 0) {
-		render_shader_setuniform(ej_render, m_loc, (UNIFORM_FORMAT)m_type, m_value);
+		backend->SetUniform(m_loc, m_type, m_value);
 		return true;
 	} else {
 		return false;
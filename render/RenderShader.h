@@ -3,22 +3,27 @@
 
 #include "../utility/typedef.h"
 
+#include <vector>
+
 #include <string.h>
 #include <assert.h>
-
-struct render;
+#include <stdint.h>
 
 namespace sl
 {
 
 class Buffer;
+class RenderBackend;
+class RenderContext;
 class RenderBuffer;
 class RenderLayout;
+class ObserverMVP;
+class StagingArena;
 
 class RenderShader
 {
 public:
-	RenderShader(render* ej_render);
+	RenderShader(RenderContext* rc, int id);
 	~RenderShader();
 
 	void Load(const char* vs, const char* fs);
@@ -31,6 +36,13 @@ public:
 	const RenderBuffer* GetVertexBuffer() const { return m_vb; }
 	const RenderBuffer* GetIndexBuffer() const { return m_ib; }
 
+	// the vertex buffer has no memory of its own, borrow it when filling
+	void SetStagingArena(StagingArena* arena) { m_arena = arena; }
+
+	// pulled on Bind() and Commit()
+	void SetMVP(ObserverMVP* mvp) { m_mvp = mvp; }
+	const ObserverMVP* GetMVP() const { return m_mvp; }
+
 	/**
 	 *  @note
 	 *    Must only called by RenderContext::BindShader()
@@ -39,24 +51,84 @@ public:
 
 	void Commit();
 
+	/**
+	 *  @brief
+	 *    draw recorded data directly, used by CommandList
+	 *  @param
+	 *    stat_type	the shader type recorded with the data, for RenderStat
+	 */
+	void Submit(DRAW_MODE_TYPE mode, const void* vb, int vb_n, const void* ib, int ib_n, int stat_type);
+
+	/**
+	 *  @brief
+	 *    draw buffers uploaded by the caller instead of the staged ones, 
+	 *    used by StaticBatch and SpritePool
+	 *  @param
+	 *    n			indices if ib, or vertices
+	 */
+	void DrawRetained(DRAW_MODE_TYPE mode, RenderBuffer* vb, RenderBuffer* ib, int n);
+	// send the changed uniforms before DrawRetained()
+	void ApplyUniforms();
+
+	int GetID() const { return m_id; }
+
 	void SetDrawMode(DRAW_MODE_TYPE dm);
+	DRAW_MODE_TYPE GetDrawMode() const { return m_draw_mode; }
 
 	bool IsUniformChanged() const { return m_uniform_changed; }
 
+	/**
+	 *  @brief
+	 *    set by the owner shader when it stages vertices for this program
+	 *    outside the vertex buffer, cleared by Commit()
+	 */
+	void SetQueued(bool queued) { m_queued = queued; }
+	// has draws pending with the current uniform values
+	bool IsQueued() const;
+
 	int AddUniform(const char* name, UNIFORM_FORMAT_TYPE t);
-	void SetUniform(int index, UNIFORM_FORMAT_TYPE t, const float* v);
+	/**
+	 *  @param
+	 *    flush		false if the value is also the one for the queued draws
+	 */
+	void SetUniform(int index, UNIFORM_FORMAT_TYPE t, const float* v, bool flush = true);
+
+	// changes whenever a uniform value changes
+	int GetUniformVersion() const { return m_uniform_version; }
+	// append MAX_UNIFORM_SIZE floats for each uniform
+	void GetUniformValues(std::vector<float>& dst) const;
+	void ApplyUniformValues(const float* src);
 
 	void Draw(void* vb, int vb_n, void* ib = NULL, int ib_n = 0);
 
+	/**
+	 *  @brief
+	 *    like Draw(), but return the vertex memory to write in place,
+	 *    the ib_n indices are the static ones already in the index buffer
+	 */
+	void* Map(int vb_n, int ib_n = 0);
+
+	// end of frame for RenderStat
 	static void DCCountEnd();
 
+	static int GetUniformSize(UNIFORM_FORMAT_TYPE t);
+
+	static const int MAX_UNIFORM_SIZE = 16;
+
 private:
 	void ApplyUniform();
 
-	static int GetUniformSize(UNIFORM_FORMAT_TYPE t);
+	void DrawBuffers(int stat_type);
+
+	void DrawElements(const void* vb, int vb_n, const void* ib, int ib_n);
+	// non-indexed, split at primitive boundaries if larger than the buffer
+	void DrawArrays(const uint8_t* vb, int n);
+
+	void BorrowStaging();
+	static void FlushStaging(void* owner);
 
 private:
-	static const int MAX_UNIFORM = 16;
+	static const int MAX_UNIFORM = 32;
 
 	class Uniform 
 	{
@@ -68,19 +140,26 @@ private:
 		void Assign(int loc, UNIFORM_FORMAT_TYPE type);
 		void Assign(UNIFORM_FORMAT_TYPE t, const float* v);
 
-		bool Apply(render* ej_render);
+		bool Apply(RenderBackend* backend);
+
+		int GetLocation() const { return m_loc; }
+		UNIFORM_FORMAT_TYPE GetType() const { return m_type; }
+		const float* GetValue() const { return m_value; }
 
 	private:
 		int m_loc;
 		UNIFORM_FORMAT_TYPE m_type;
 
 		bool m_changed;
-		float m_value[16];
+		float m_value[MAX_UNIFORM_SIZE];
 
 	}; // Uniform
 
 private:
-	render* m_ej_render;
+	RenderContext* m_rc;
+	RenderBackend* m_backend;
+
+	int m_id;
 
 	int m_prog;
 
@@ -89,13 +168,18 @@ private:
 	int m_uniform_number;
 	Uniform m_uniform[MAX_UNIFORM];
 	bool m_uniform_changed;
+	int m_uniform_version;
+
+	bool m_queued;
 
 	RenderBuffer *m_vb, *m_ib;
 	RenderLayout* m_layout;
 
-	DRAW_MODE_TYPE m_draw_mode;
+	ObserverMVP* m_mvp;
 
-	static int m_dc_count;
+	StagingArena* m_arena;
+
+	DRAW_MODE_TYPE m_draw_mode;
 
 }; // RenderShader
 
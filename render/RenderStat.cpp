@@ -0,0 +1,31 @@
+#include "RenderStat.h"
+
+#include <string.h>
+
+namespace sl
+{
+
+RenderStat* RenderStat::m_instance = NULL;
+
+RenderStat* RenderStat::Instance()
+{
+	if (!m_instance) {
+		m_instance = new RenderStat;
+	}
+	return m_instance;
+}
+
+RenderStat::RenderStat()
+	: m_reason(FR_OTHER)
+{
+	memset(&m_curr, 0, sizeof(m_curr));
+	memset(&m_last, 0, sizeof(m_last));
+}
+
+void RenderStat::EndFrame()
+{
+	m_last = m_curr;
+	memset(&m_curr, 0, sizeof(m_curr));
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#ifndef _SHADERLAB_RENDER_STAT_H_
+#define _SHADERLAB_RENDER_STAT_H_
+
+#include "../shader/ShaderType.h"
+
+#include <stddef.h>
+
+namespace sl
+{
+
+/**
+ *  @note
+ *    the values should same as SL_FLUSH_REASON
+ */
+enum FLUSH_REASON
+{
+	FR_TEXTURE = 0,
+	FR_UNIFORM,
+	FR_BLEND,
+	FR_DRAW_MODE,
+	FR_VB_OVERFLOW,
+	FR_IB_OVERFLOW,
+	FR_SHADER,
+	FR_FLUSH,
+	FR_OTHER,
+
+	FR_MAX_COUNT
+};
+
+struct DrawStat
+{
+	int dc;
+	int vertices;
+	int bytes;
+	int flush[FR_MAX_COUNT];
+};
+
+struct FrameStat
+{
+	DrawStat total;
+	DrawStat shaders[MAX_SHADER];
+};
+
+/**
+ *  @brief
+ *    per-frame draw call counters, keyed by why the batch was flushed
+ */
+class RenderStat
+{
+public:
+	/**
+	 *  @return
+	 *    previous reason
+	 */
+	FLUSH_REASON SetReason(FLUSH_REASON reason) {
+		FLUSH_REASON prev = m_reason;
+		m_reason = reason;
+		return prev;
+	}
+
+	void AddDrawCall(int shader, int vertices, int bytes) {
+		Add(m_curr.total, vertices, bytes);
+		if (shader >= 0 && shader < MAX_SHADER) {
+			Add(m_curr.shaders[shader], vertices, bytes);
+		}
+	}
+
+	void EndFrame();
+
+	// last finished frame
+	const FrameStat& GetFrame() const { return m_last; }
+
+	static RenderStat* Instance();
+
+private:
+	RenderStat();
+
+	void Add(DrawStat& stat, int vertices, int bytes) {
+		++stat.dc;
+		stat.vertices += vertices;
+		stat.bytes += bytes;
+		++stat.flush[m_reason];
+	}
+
+private:
+	FLUSH_REASON m_reason;
+
+	FrameStat m_curr, m_last;
+
+private:
+	static RenderStat* m_instance;
+
+}; // RenderStat
+
+/**
+ *  @brief
+ *    draws issued inside the scope are attributed to the reason
+ */
+class FlushReasonScope
+{
+public:
+	FlushReasonScope(FLUSH_REASON reason) {
+		m_prev = RenderStat::Instance()->SetReason(reason);
+	}
+	~FlushReasonScope() {
+		RenderStat::Instance()->SetReason(m_prev);
+	}
+
+private:
+	FLUSH_REASON m_prev;
+
+}; // FlushReasonScope
+
+}
+
+#endif // _SHADERLAB_RENDER_STAT_H_
\ No newline at end of file
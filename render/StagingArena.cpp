@@ -0,0 +1,59 @@
+#include "StagingArena.h"
+
+#include <stddef.h>
+
+namespace sl
+{
+
+StagingArena::StagingArena()
+	: m_data(NULL)
+	, m_cap(0)
+	, m_size(0)
+	, m_owner(NULL)
+	, m_flush(NULL)
+{
+}
+
+StagingArena::~StagingArena()
+{
+	delete[] m_data;
+}
+
+void StagingArena::Reserve(int bytes)
+{
+	if (bytes > m_size) {
+		m_size = bytes;
+	}
+}
+
+unsigned char* StagingArena::Borrow(void* owner, FlushFunc flush)
+{
+	if (owner == m_owner && m_cap >= m_size) {
+		return m_data;
+	}
+
+	if (m_owner) {
+		void* old = m_owner;
+		m_owner = NULL;
+		m_flush(old);
+	}
+	if (m_cap < m_size) {
+		delete[] m_data;
+		m_data = new unsigned char[m_size];
+		m_cap = m_size;
+	}
+
+	m_owner = owner;
+	m_flush = flush;
+	return m_data;
+}
+
+void StagingArena::Release(void* owner)
+{
+	if (m_owner == owner) {
+		m_owner = NULL;
+		m_flush = NULL;
+	}
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef _SHADERLAB_STAGING_ARENA_H_
+#define _SHADERLAB_STAGING_ARENA_H_
+
+namespace sl
+{
+
+/**
+ *  @brief
+ *    one block of memory for staged vertices, lent to one owner at a time
+ *
+ *  @remarks
+ *    only the batch being built needs the memory, so the former owner's
+ *    staged vertices are flushed before another owner takes it.
+ */
+class StagingArena
+{
+public:
+	typedef void (*FlushFunc)(void* owner);
+
+public:
+	StagingArena();
+	~StagingArena();
+
+	// the largest size any owner will use
+	void Reserve(int bytes);
+
+	unsigned char* Borrow(void* owner, FlushFunc flush);
+	// owner is deleted
+	void Release(void* owner);
+
+	int Size() const { return m_size; }
+
+private:
+	unsigned char* m_data;
+	int m_cap, m_size;
+
+	void* m_owner;
+	FlushFunc m_flush;
+
+}; // StagingArena
+
+}
+
+#endif // _SHADERLAB_STAGING_ARENA_H_
\ No newline at end of file
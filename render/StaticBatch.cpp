@@ -0,0 +1,178 @@
+#include "StaticBatch.h"
+#include "RenderShader.h"
+#include "RenderBuffer.h"
+#include "RenderBackend.h"
+#include "RenderStat.h"
+#include "../shader/ObserverMVP.h"
+#include "../utility/Buffer.h"
+#include "../utility/Trace.h"
+
+#include <render/render.h>
+
+#include <string.h>
+
+namespace sl
+{
+
+StaticBatch::StaticBatch()
+{
+}
+
+StaticBatch::~StaticBatch()
+{
+	Clear();
+}
+
+void StaticBatch::Add(RenderShader* shader, const CommandList::State& state, int stat_type)
+{
+	const RenderBuffer* vb = shader->GetVertexBuffer();
+	const RenderBuffer* ib = shader->GetIndexBuffer();
+
+	m_values.clear();
+	shader->GetUniformValues(m_values);
+
+	if (m_runs.empty() || !CanMerge(m_runs.back(), shader, state)) 
+	{
+		Run run;
+		run.shader = shader;
+		run.state = state;
+		run.mode = shader->GetDrawMode();
+		run.stat_type = stat_type;
+		run.uniform = m_uniforms.size();
+		m_uniforms.insert(m_uniforms.end(), m_values.begin(), m_values.end());
+		run.vb_n = 0;
+		run.vb = run.ib = NULL;
+		m_runs.push_back(run);
+	}
+
+	Run& run = m_runs.back();
+	const uint8_t* src = vb->Data();
+	run.vb_data.insert(run.vb_data.end(), src, src + vb->Size() * vb->Stride());
+	if (ib) {
+		const uint16_t* idx = (const uint16_t*)ib->Data();
+		for (int i = 0, n = ib->Size(); i < n; ++i) {
+			run.ib_data.push_back(idx[i] + run.vb_n);
+		}
+	}
+	run.vb_n += vb->Size();
+}
+
+void StaticBatch::Finish(RenderBackend* backend)
+{
+	for (int i = 0, n = m_runs.size(); i < n; ++i)
+	{
+		Run& run = m_runs[i];
+		if (run.vb) {
+			continue;
+		}
+
+		int stride = run.shader->GetVertexBuffer()->Stride();
+		Buffer* vb = new Buffer(stride, run.vb_n);
+		vb->Add(&run.vb_data[0], run.vb_n);
+		run.vb = new RenderBuffer(backend, VERTEXBUFFER, stride, run.vb_n, vb);
+		run.vb->Update();
+		std::vector<uint8_t>().swap(run.vb_data);
+
+		if (!run.ib_data.empty()) {
+			int ib_n = run.ib_data.size();
+			Buffer* ib = new Buffer(sizeof(uint16_t), ib_n);
+			ib->Add(&run.ib_data[0], ib_n);
+			run.ib = new RenderBuffer(backend, INDEXBUFFER, sizeof(uint16_t), ib_n, ib);
+			run.ib->Update();
+			std::vector<uint16_t>().swap(run.ib_data);
+		}
+	}
+}
+
+void StaticBatch::Clear()
+{
+	for (int i = 0, n = m_runs.size(); i < n; ++i) {
+		Run& run = m_runs[i];
+		if (run.vb) {
+			run.vb->RemoveReference();
+		}
+		if (run.ib) {
+			run.ib->RemoveReference();
+		}
+	}
+	m_runs.clear();
+	m_uniforms.clear();
+}
+
+void StaticBatch::Draw(RenderBackend* backend, const sm::mat4* mv) const
+{
+	SL_TRACE_SCOPE("StaticBatch::Draw");
+
+	RenderShader* bound = NULL;
+	CommandList::State curr;
+	for (int i = 0, n = m_runs.size(); i < n; ++i)
+	{
+		const Run& run = m_runs[i];
+		if (!run.vb) {
+			continue;
+		}
+
+		RenderShader* shader = run.shader;
+		if (shader != bound) {
+			RestoreUniforms(bound);
+			// pull the current matrices
+			shader->Bind();
+			m_saved.clear();
+			shader->GetUniformValues(m_saved);
+		}
+		CommandList::ApplyState(backend, bound ? &curr : NULL, run.state);
+		curr = run.state;
+		bound = shader;
+
+		// the recorded uniforms with the current projection
+		int sz = m_saved.size();
+		m_values.assign(m_uniforms.begin() + run.uniform, m_uniforms.begin() + run.uniform + sz);
+		if (const ObserverMVP* mvp = shader->GetMVP()) 
+		{
+			int proj = mvp->GetProjectionIndex() * RenderShader::MAX_UNIFORM_SIZE;
+			if (proj >= 0) {
+				memcpy(&m_values[proj], &m_saved[proj], sizeof(float) * 16);
+			}
+			int modelview = mvp->GetModelviewIndex() * RenderShader::MAX_UNIFORM_SIZE;
+			if (mv && modelview >= 0) {
+				sm::mat4 mat = sm::mat4(&m_values[modelview]) * *mv;
+				memcpy(&m_values[modelview], mat.x, sizeof(float) * 16);
+			}
+		}
+		if (sz > 0) {
+			shader->ApplyUniformValues(&m_values[0]);
+		}
+
+		shader->DrawRetained(run.mode, run.vb, run.ib, run.ib ? run.ib->Size() : run.vb_n);
+		RenderStat::Instance()->AddDrawCall(run.stat_type, run.vb_n, 0);
+	}
+	RestoreUniforms(bound);
+}
+
+bool StaticBatch::CanMerge(const Run& run, RenderShader* shader, const CommandList::State& state) const
+{
+	if (run.shader != shader || 
+		run.mode != shader->GetDrawMode() ||
+		memcmp(&run.state, &state, sizeof(state)) != 0) {
+		return false;
+	}
+	if (run.mode != DRAW_POINTS && run.mode != DRAW_LINES && run.mode != DRAW_TRIANGLES) {
+		return false;
+	}
+	// 16 bits indices
+	const RenderBuffer* ib = shader->GetIndexBuffer();
+	if (ib && run.vb_n + shader->GetVertexBuffer()->Size() > 0x10000) {
+		return false;
+	}
+	return m_values.empty() || 
+		memcmp(&m_uniforms[run.uniform], &m_values[0], sizeof(float) * m_values.size()) == 0;
+}
+
+void StaticBatch::RestoreUniforms(RenderShader* shader) const
+{
+	if (shader && !m_saved.empty()) {
+		shader->ApplyUniformValues(&m_saved[0]);
+	}
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#ifndef _SHADERLAB_STATIC_BATCH_H_
+#define _SHADERLAB_STATIC_BATCH_H_
+
+#include "CommandList.h"
+#include "../utility/typedef.h"
+
+#include <SM_Matrix.h>
+
+#include <vector>
+
+#include <stdint.h>
+
+namespace sl
+{
+
+class RenderShader;
+class RenderBackend;
+class RenderBuffer;
+
+/**
+ *  @brief
+ *    draws recorded once and kept on the device, for the layers that
+ *    don't change between frames
+ *
+ *  @remarks
+ *    adjacent commits with the same state are merged into one run, each run
+ *    owns its vertex and index buffers. Replaying binds and draws the runs,
+ *    nothing is packed or uploaded again.
+ */
+class StaticBatch
+{
+public:
+	StaticBatch();
+	~StaticBatch();
+
+	// called by RenderContext::Defer() while recording
+	void Add(RenderShader* shader, const CommandList::State& state, int stat_type);
+
+	// upload the runs, no more Add() after it
+	void Finish(RenderBackend* backend);
+
+	void Clear();
+
+	/**
+	 *  @param
+	 *    mv		applied after the recorded modelview, NULL to keep it
+	 */
+	void Draw(RenderBackend* backend, const sm::mat4* mv) const;
+
+	bool IsEmpty() const { return m_runs.empty(); }
+
+private:
+	struct Run
+	{
+		RenderShader* shader;
+		CommandList::State state;
+		DRAW_MODE_TYPE mode;
+		int stat_type;
+
+		// offset in m_uniforms
+		int uniform;
+
+		// only until Finish()
+		std::vector<uint8_t> vb_data;
+		std::vector<uint16_t> ib_data;
+		int vb_n;
+
+		RenderBuffer *vb, *ib;
+	};
+
+private:
+	bool CanMerge(const Run& run, RenderShader* shader, const CommandList::State& state) const;
+
+	void RestoreUniforms(RenderShader* shader) const;
+
+private:
+	std::vector<Run> m_runs;
+
+	std::vector<float> m_uniforms;
+
+	// uniform values of the shader being replayed, and the ones before
+	mutable std::vector<float> m_values, m_saved;
+
+}; // StaticBatch
+
+}
+
+#endif // _SHADERLAB_STATIC_BATCH_H_
\ No newline at end of file
@@ -0,0 +1,33 @@
+#include "StreamRing.h"
+#include "RenderBackend.h"
+
+#include <render/render.h>
+
+namespace sl
+{
+
+StreamRing::StreamRing(RenderBackend* backend, int stride, int count)
+	: m_backend(backend)
+	, m_curr(0)
+{
+	m_count = count < MAX_STREAM_BUFFER ? count : MAX_STREAM_BUFFER;
+	for (int i = 0; i < m_count; ++i) {
+		// sized by the uploads
+		m_ids[i] = m_backend->CreateBuffer(VERTEXBUFFER, NULL, 0, stride);
+	}
+}
+
+StreamRing::~StreamRing()
+{
+	for (int i = 0; i < m_count; ++i) {
+		m_backend->Release(VERTEXBUFFER, m_ids[i]);
+	}
+}
+
+RID StreamRing::Next()
+{
+	m_curr = (m_curr + 1) % m_count;
+	return m_ids[m_curr];
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#ifndef _SHADERLAB_STREAM_RING_H_
+#define _SHADERLAB_STREAM_RING_H_
+
+#include "RenderConst.h"
+#include "../utility/typedef.h"
+
+#include <CU_RefCountObj.h>
+
+namespace sl
+{
+
+class RenderBackend;
+
+/**
+ *  @brief
+ *    device vertex buffers taken in turn by every streaming RenderBuffer
+ *    of the same stride
+ *
+ *  @remarks
+ *    each upload refills the whole buffer, so any user can take the next
+ *    one, and the draws still reading the former ones are not waited for.
+ */
+class StreamRing : public cu::RefCountObj
+{
+public:
+	StreamRing(RenderBackend* backend, int stride, int count);
+	virtual ~StreamRing();
+
+	RID Next();
+
+private:
+	RenderBackend* m_backend;
+
+	RID m_ids[MAX_STREAM_BUFFER];
+	int m_count, m_curr;
+
+}; // StreamRing
+
+}
+
+#endif // _SHADERLAB_STREAM_RING_H_
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef _SHADERLAB_BATCH_COST_H_
+#define _SHADERLAB_BATCH_COST_H_
+
+namespace sl
+{
+
+/**
+ *  @brief
+ *    weights to choose between upgrading a batch's color program and
+ *    splitting it into one more draw call, in bytes uploaded
+ */
+struct BatchCost
+{
+	float draw_call;
+	float vertex_byte;
+	// per quad, indexed by prog type: none, multi add, map, full
+	float fragment[4];
+
+	BatchCost() {
+		draw_call = 2048;
+		vertex_byte = 1;
+		fragment[0] = 0;
+		fragment[1] = 16;
+		fragment[2] = 48;
+		fragment[3] = 64;
+	}
+};
+
+}
+
+#endif // _SHADERLAB_BATCH_COST_H_
\ No newline at end of file
@@ -1,9 +1,9 @@
 #include "BlendShader.h"
 #include "SubjectMVP2.h"
-#include "Utility.h"
 #include "../render/RenderContext.h"
 #include "../render/RenderBuffer.h"
 #include "../render/RenderShader.h"
+#include "../render/RenderStat.h"
 #include "../parser/AttributeNode.h"
 #include "../parser/VaryingNode.h"
 #include "../parser/PositionTrans.h"
@@ -11,6 +11,7 @@
 #include "../parser/ColorAddMul.h"
 #include "../parser/Blend.h"
 #include "../parser/FragColor.h"
+#include "../utility/Trace.h"
 
 #include <render/render.h>
 
@@ -35,8 +36,6 @@ BlendShader::BlendShader(RenderContext* rc)
 
 	InitVAList();
 	InitProg();
-
-	m_vertex_buf = new Vertex[MAX_COMMBINE * 4];
 }
 
 BlendShader::~BlendShader()
@@ -55,17 +54,23 @@ void BlendShader::UnBind() const
 
 void BlendShader::Commit() const
 {
+	SL_TRACE_SCOPE("BlendShader::Commit");
+
 	m_rc->SetTexture(m_tex_blend, 0);
 	m_rc->SetTexture(m_tex_base, 1);
 	
 	RenderShader* shader = m_prog->GetShader();
 	m_rc->BindShader(shader);
-	shader->Draw(m_vertex_buf, m_quad_sz * 4, NULL, m_quad_sz * 6);
 	m_quad_sz = 0;
 
 	shader->Commit();
 }
 
+const SubjectMVP* BlendShader::GetSubject() const
+{
+	return SubjectMVP2::Instance();
+}
+
 void BlendShader::SetColor(uint32_t color, uint32_t additive)
 {
 	m_color = color;
@@ -75,6 +80,7 @@ void BlendShader::SetColor(uint32_t color, uint32_t additive)
 void BlendShader::SetMode(int mode)
 {
 	if (mode != m_curr_mode) {
+		FlushReasonScope scope(FR_UNIFORM);
 		Commit();
 	}
 	m_curr_mode = (SL_BLEND_MODE)mode;
@@ -84,17 +90,30 @@ void BlendShader::SetMode(int mode)
 void BlendShader::Draw(const float* positions, const float* texcoords_blend, 
 					   const float* texcoords_base, int tex_blend, int tex_base) const
 {
+	float trans[8];
+	positions = SubjectMVP2::Instance()->Transform(positions, 4, trans);
+
 	if (m_quad_sz >= MAX_COMMBINE || 
 		(m_tex_blend != tex_blend && m_tex_blend != 0) ||
 		(m_tex_base != tex_base && m_tex_base != 0)) {
+		FlushReasonScope scope(m_quad_sz >= MAX_COMMBINE ? FR_VB_OVERFLOW : FR_TEXTURE);
 		Commit();
 	}
 	m_tex_blend = tex_blend;
 	m_tex_base = tex_base;
 
+	// vertices are written in place, so the state must be set before them
+	RenderShader* shader = m_prog->GetShader();
+	if (m_quad_sz == 0) {
+		m_rc->SetTexture(m_tex_blend, 0);
+		m_rc->SetTexture(m_tex_base, 1);
+		m_rc->BindShader(shader);
+	}
+
+	Vertex* vertices = static_cast<Vertex*>(shader->Map(4, 6));
 	for (int i = 0; i < 4; ++i) 
 	{
-		Vertex* v	= &m_vertex_buf[m_quad_sz * 4 + i];
+		Vertex* v	= &vertices[i];
 		v->vx		= positions[i * 2];
 		v->vy		= positions[i * 2 + 1];
 		v->tx_blend = texcoords_blend[i * 2];
@@ -125,7 +144,7 @@ void BlendShader::InitProg()
  	va_list.push_back(m_va_list[COLOR]);
  	va_list.push_back(m_va_list[ADDITIVE]);
 
-	RenderBuffer* idx_buf = Utility::CreateQuadIndexBuffer(m_rc, MAX_COMMBINE);
+	RenderBuffer* idx_buf = m_rc->FetchQuadIndexBuffer(MAX_COMMBINE);
 	m_prog = new Program(m_rc, va_list, idx_buf);
 	idx_buf->RemoveReference();
 }
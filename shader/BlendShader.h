@@ -22,6 +22,7 @@ public:
 	virtual void Bind() const;
 	virtual void UnBind() const;
 	virtual void Commit() const;
+	virtual const SubjectMVP* GetSubject() const;
 
 	void SetColor(uint32_t color, uint32_t additive);
 
@@ -79,7 +80,6 @@ private:
 
 	mutable int m_tex_blend, m_tex_base;
 
-	Vertex* m_vertex_buf;
 	mutable int m_quad_sz;
 
 }; // BlendShader
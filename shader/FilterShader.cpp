@@ -1,5 +1,4 @@
 #include "FilterShader.h"
-#include "Utility.h"
 #include "SubjectMVP2.h"
 #include "EdgeDetectProg.h"
 #include "ReliefProg.h"
@@ -15,8 +14,10 @@
 #include "../render/RenderContext.h"
 #include "../render/RenderBuffer.h"
 #include "../render/RenderShader.h"
+#include "../render/RenderStat.h"
 #include "../parser/ColorAddMul.h"
-#include "../utility/StackAllocator.h"
+#include "../utility/Trace.h"
+#include "../utility/VertexPack.h"
 
 #include <render/render.h>
 
@@ -38,7 +39,8 @@ FilterShader::FilterShader(RenderContext* rc)
 	, m_index_buf(NULL)
 	, m_prog_type(0)
 {
-	m_vertex_buf = new Vertex[MAX_COMMBINE * 4];
+	m_vertex_buf = NULL;
+	m_rc->GetQuadArena()->Reserve(sizeof(Vertex) * MAX_COMMBINE * 4);
 
 	m_rc->SetClearFlag(MASKC);
 
@@ -51,6 +53,8 @@ FilterShader::FilterShader(RenderContext* rc)
 
 FilterShader::~FilterShader()
 {
+	m_rc->GetQuadArena()->Release(this);
+
 	if (m_index_buf) {
 		m_index_buf->RemoveReference();
 	}
@@ -77,6 +81,8 @@ void FilterShader::UnBind() const
 
 void FilterShader::Commit() const
 {
+	SL_TRACE_SCOPE("FilterShader::Commit");
+
 	if (m_quad_sz == 0 || m_curr_mode == FM_NULL) {
 		return;
 	}
@@ -98,6 +104,9 @@ void FilterShader::Commit() const
 	if (!prog) {
         m_quad_sz = 0;
         m_prog_type = 0;
+		if (m_programs[idx]) {
+			m_programs[idx]->GetShader()->SetQueued(false);
+		}
 		return;
 	}
 
@@ -105,26 +114,32 @@ void FilterShader::Commit() const
 	RenderShader* shader = prog->GetShader();
 	m_rc->BindShader(shader);
 
-	int vertex_sz = prog->GetVertexSize();
-	int vb_count = m_quad_sz * 4;
-	int buf_sz = vertex_sz * vb_count;
-	StackAllocator* alloc = StackAllocator::Instance();
-	alloc->Reserve(buf_sz);
-	void* buf = alloc->Alloc(buf_sz);
-	uint8_t* ptr = (uint8_t*)buf;
-	for (int i = 0; i < vb_count; ++i) {
-		memcpy(ptr, &m_vertex_buf[i].vx, vertex_sz);
-		ptr += vertex_sz;
+	static const int W = sizeof(Vertex) / 4;
+	VertexPackFunc pack = NULL;
+	if (m_prog_type == PT_NULL) {
+		pack = &VertexPack<W, 4, 0, 0>::Run;
+	} else {
+		pack = &VertexPack<W, 6, 0, 0>::Run;
 	}
 
-	shader->Draw(buf, vb_count, NULL, m_quad_sz * 6);
-	alloc->Free(buf);
+	int vb_count = m_quad_sz * 4;
+	uint8_t* ptr = (uint8_t*)shader->Map(vb_count, m_quad_sz * 6);
+	{
+		SL_TRACE_SCOPE("FilterShader::Pack");
+		pack(ptr, m_vertex_buf, vb_count);
+	}
 
 	m_quad_sz = 0;
 
 	m_prog_type = 0;
 
 	shader->Commit();
+	m_programs[idx]->GetShader()->SetQueued(false);
+}
+
+const SubjectMVP* FilterShader::GetSubject() const
+{
+	return SubjectMVP2::Instance();
 }
 
 void FilterShader::SetColor(uint32_t color, uint32_t additive)
@@ -148,6 +163,7 @@ void FilterShader::ClearTime()
 void FilterShader::SetMode(FILTER_MODE mode)
 {
 	if (mode != m_curr_mode) {
+		FlushReasonScope scope(FR_SHADER);
 		Commit();
 		m_curr_mode = mode;
 		int idx = m_mode2index[m_curr_mode];
@@ -167,7 +183,11 @@ FilterProgram* FilterShader::GetProgram(FILTER_MODE mode)
 
 void FilterShader::Draw(const float* positions, const float* texcoords, int texid) const
 {
+	float trans[8];
+	positions = SubjectMVP2::Instance()->Transform(positions, 4, trans);
+
 	if (m_quad_sz >= MAX_COMMBINE || (m_texid != texid && m_texid != 0)) {
+		FlushReasonScope scope(m_quad_sz >= MAX_COMMBINE ? FR_VB_OVERFLOW : FR_TEXTURE);
 		Commit();
 	}
 	m_texid = texid;
@@ -177,6 +197,20 @@ void FilterShader::Draw(const float* positions, const float* texcoords, int texi
 		m_prog_type |= PT_MULTI_ADD_COLOR;
 	}
 
+	int idx = m_mode2index[m_curr_mode];
+	if (idx >= 0) {
+		FilterProgram* prog = m_prog_type == PT_NULL ? m_programs[idx] : m_programs_with_color[idx];
+		if (prog) {
+			prog->GetShader()->SetQueued(true);
+		}
+	}
+
+	if (m_quad_sz == 0) {
+		FlushReasonScope scope(FR_OTHER);
+		void* owner = const_cast<FilterShader*>(this);
+		m_vertex_buf = reinterpret_cast<Vertex*>(m_rc->GetQuadArena()->Borrow(owner, &Shader::FlushStaging));
+	}
+
 	for (int i = 0; i < 4; ++i) 
 	{
 		Vertex* v = &m_vertex_buf[m_quad_sz * 4 + i];
@@ -208,7 +242,7 @@ void FilterShader::InitProgs()
 	va_list.push_back(m_va_list[TEXCOORD]);
 
 	int max_vertex = MAX_COMMBINE * 4;
-	m_index_buf = Utility::CreateQuadIndexBuffer(m_rc, MAX_COMMBINE);
+	m_index_buf = m_rc->FetchQuadIndexBuffer(MAX_COMMBINE);
 
 #ifdef HAS_TEXTURE_SIZE
 	// edge detect
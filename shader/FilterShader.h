@@ -22,6 +22,7 @@ public:
 	virtual void Bind() const;
 	virtual void UnBind() const;
 	virtual void Commit() const;
+	virtual const SubjectMVP* GetSubject() const;
 
 	void SetColor(uint32_t color, uint32_t additive);
 
@@ -95,7 +96,8 @@ private:
 
 	mutable int m_texid;
 
-	Vertex* m_vertex_buf;
+	// borrowed from the quad arena when staging the first quad
+	mutable Vertex* m_vertex_buf;
 	mutable int m_quad_sz;
 
 	RenderBuffer* m_index_buf;
@@ -1,15 +1,16 @@
 #include "MaskShader.h"
 #include "SubjectMVP2.h"
-#include "Utility.h"
 #include "../render/RenderContext.h"
 #include "../render/RenderBuffer.h"
 #include "../render/RenderShader.h"
+#include "../render/RenderStat.h"
 #include "../parser/Mask.h"
 #include "../parser/AttributeNode.h"
 #include "../parser/VaryingNode.h"
 #include "../parser/PositionTrans.h"
 #include "../parser/TextureMap.h"
 #include "../parser/FragColor.h"
+#include "../utility/Trace.h"
 
 #include <render/render.h>
 
@@ -29,8 +30,6 @@ MaskShader::MaskShader(RenderContext* rc)
 
 	InitVAList();
 	InitProg();
-
-	m_vertex_buf = new Vertex[MAX_COMMBINE * 4];
 }
 
 MaskShader::~MaskShader()
@@ -49,31 +48,50 @@ void MaskShader::UnBind() const
 
 void MaskShader::Commit() const
 {
+	SL_TRACE_SCOPE("MaskShader::Commit");
+
 	m_rc->SetTexture(m_tex, 0);
 	m_rc->SetTexture(m_tex_mask, 1);
 
 	RenderShader* shader = m_prog->GetShader();
 	m_rc->BindShader(shader);
-	shader->Draw(m_vertex_buf, m_quad_sz * 4, NULL, m_quad_sz * 6);
 	m_quad_sz = 0;
 
 	shader->Commit();
 }
 
+const SubjectMVP* MaskShader::GetSubject() const
+{
+	return SubjectMVP2::Instance();
+}
+
 void MaskShader::Draw(const float* positions, const float* texcoords, 
 					  const float* texcoords_mask, int tex, int tex_mask) const
 {
+	float trans[8];
+	positions = SubjectMVP2::Instance()->Transform(positions, 4, trans);
+
 	if (m_quad_sz >= MAX_COMMBINE || 
 		(m_tex != tex && m_tex != 0) ||
 		(m_tex_mask != tex_mask && m_tex_mask != 0)) {
+		FlushReasonScope scope(m_quad_sz >= MAX_COMMBINE ? FR_VB_OVERFLOW : FR_TEXTURE);
 		Commit();
 	}
 	m_tex = tex;
 	m_tex_mask = tex_mask;
 
+	// vertices are written in place, so the state must be set before them
+	RenderShader* shader = m_prog->GetShader();
+	if (m_quad_sz == 0) {
+		m_rc->SetTexture(m_tex, 0);
+		m_rc->SetTexture(m_tex_mask, 1);
+		m_rc->BindShader(shader);
+	}
+
+	Vertex* vertices = static_cast<Vertex*>(shader->Map(4, 6));
 	for (int i = 0; i < 4; ++i) 
 	{
-		Vertex* v	= &m_vertex_buf[m_quad_sz * 4 + i];
+		Vertex* v	= &vertices[i];
 		v->vx		= positions[i * 2];
 		v->vy		= positions[i * 2 + 1];
 		v->tx		= texcoords[i * 2];
@@ -98,7 +116,7 @@ void MaskShader::InitProg()
 	va_list.push_back(m_va_list[TEXCOORD]);
 	va_list.push_back(m_va_list[TEXCOORD_MASK]);
 
-	RenderBuffer* idx_buf = Utility::CreateQuadIndexBuffer(m_rc, MAX_COMMBINE);
+	RenderBuffer* idx_buf = m_rc->FetchQuadIndexBuffer(MAX_COMMBINE);
 	m_prog = new Program(m_rc, va_list, idx_buf);
 	idx_buf->RemoveReference();
 }
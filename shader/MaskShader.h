@@ -19,6 +19,7 @@ public:
 	virtual void Bind() const;
 	virtual void UnBind() const;
 	virtual void Commit() const;
+	virtual const SubjectMVP* GetSubject() const;
 
 	void Draw(const float* positions, const float* texcoords, 
 		const float* texcoords_mask, int tex, int tex_mask) const;
@@ -58,7 +59,6 @@ private:
 
 	mutable int m_tex, m_tex_mask;
 
-	Vertex* m_vertex_buf;
 	mutable int m_quad_sz;
 
 }; // MaskShader
@@ -6,7 +6,9 @@
 #include "../render/RenderContext.h"
 #include "../render/RenderShader.h"
 #include "../render/RenderBuffer.h"
+#include "../render/RenderStat.h"
 #include "../parser/PositionTrans.h"
+#include "../parser/PositionTransPalette.h"
 #include "../parser/AttributeNode.h"
 #include "../parser/VaryingNode.h"
 #include "../parser/FragColor.h"
@@ -15,7 +17,8 @@
 #include "../parser/TextureMap.h"
 #include "../parser/Assign.h"
 #include "../parser/Mul2.h"
-#include "../utility/StackAllocator.h"
+#include "../utility/FrameArena.h"
+#include "../utility/Trace.h"
 
 #include <render/render.h>
 #include <ds_array.h>
@@ -29,9 +32,13 @@ static const int MAX_INDICES = 20000;
 Model3Shader::Model3Shader(RenderContext* rc)
 	: Shader(rc)
 	, m_curr_shader(-1)
+	, m_palette_mode(false)
+	, m_transform_slot(-1)
 {
 	m_rc->SetClearFlag(MASKC | MASKD);
 
+	m_modelview.Identity();
+
 	InitVAList();
 	InitProgs();
 }
@@ -53,15 +60,27 @@ void Model3Shader::UnBind() const
 
 void Model3Shader::Commit() const
 {
+	SL_TRACE_SCOPE("Model3Shader::Commit");
+
 	if (m_curr_shader < 0) {
 		return;
 	}
 
 	RenderShader* shader = m_programs[m_curr_shader]->GetShader();
-	struct render* r = m_rc->GetEJRender();
-	render_setdepth(r, DEPTH_LESS_EQUAL);
+	if (m_curr_shader >= PI_PALETTE_COLOR && !m_palette.Empty()) {
+		m_palette.Upload(shader, m_palette_uniforms[m_curr_shader - PI_PALETTE_COLOR]);
+	}
+	m_palette.Clear();
+	m_transform_slot = -1;
+
+	m_rc->SetDepth(DEPTH_LESS_EQUAL);
 	shader->Commit();
-	render_setdepth(r, DEPTH_DISABLE);
+	m_rc->SetDepth(DEPTH_DISABLE);
+}
+
+const SubjectMVP* Model3Shader::GetSubject() const
+{
+	return SubjectMVP3::Instance();
 }
 
 void Model3Shader::SetMaterial(const sm::vec3& ambient, const sm::vec3& diffuse, 
@@ -70,7 +89,12 @@ void Model3Shader::SetMaterial(const sm::vec3& ambient, const sm::vec3& diffuse,
 	m_shading_uniforms.SetMaterial(m_programs[PI_GOURAUD_SHADING]->GetShader(), ambient, diffuse, specular, shininess);
 	m_shading_uniforms.SetMaterial(m_programs[PI_GOURAUD_TEXTURE]->GetShader(), ambient, diffuse, specular, shininess);
 	if (tex >= 0) {
-		render_setdepth(m_rc->GetEJRender(), DEPTH_LESS_EQUAL);
+		// through this Commit(), the queued palette draws need their u_palette
+		if (tex != m_rc->GetTexture()) {
+			FlushReasonScope scope(FR_TEXTURE);
+			Commit();
+		}
+		m_rc->SetDepth(DEPTH_LESS_EQUAL);
 		m_rc->SetTexture(tex, 0);
 	}
 }
@@ -89,7 +113,15 @@ void Model3Shader::Draw(const ds_array* vertices, const ds_array* indices,
 	if ( has_normal && !has_texcoord) idx = PI_GOURAUD_SHADING;
 	if (!has_normal &&  has_texcoord) idx = PI_TEXTURE_MAP;
 	if ( has_normal &&  has_texcoord) idx = PI_GOURAUD_TEXTURE;
+	// lit ones need the normal matrix, still use the modelview uniform
+	bool palette = m_palette_mode && !has_normal;
+	if (palette) {
+		idx = has_texcoord ? PI_PALETTE_TEXTURE : PI_PALETTE_COLOR;
+	} else if (m_palette_mode) {
+		ApplyModelView();
+	}
 	if (idx != m_curr_shader) {
+		FlushReasonScope scope(FR_SHADER);
 		Commit();
 		m_curr_shader = idx;
 		m_rc->BindShader(m_programs[idx]->GetShader());
@@ -100,31 +132,42 @@ void Model3Shader::Draw(const ds_array* vertices, const ds_array* indices,
 		               *ib = shader->GetIndexBuffer();
 	int vn = ds_array_size(vertices),
 		in = ds_array_size(indices);
-	if (vb->Size() + vn > vb->Capacity() || 
-		ib->Size() + in > ib->Capacity()) {
-		Commit();
-	}
 	if (vn > vb->Capacity() || in > ib->Capacity()) {
+		DrawSplit(shader, vertices, indices, palette);
 		return;
 	}
-	
-	int ioffset = vb->Size();
-	int isz = ds_array_size(indices);
-	StackAllocator* alloc = StackAllocator::Instance();
-	alloc->Reserve(sizeof(uint16_t) * isz);
-	void* buf = alloc->Alloc(sizeof(uint16_t) * isz);
-	uint16_t* array = (uint16_t*)buf;
-	memcpy(buf, ds_array_data(indices), sizeof(uint16_t) * isz);
-	for (int i = 0; i < isz; ++i) {
-		array[i] += ioffset;
-	}
-	shader->Draw((void*)ds_array_data(vertices), vn, buf, in);
-	alloc->Free(buf);
+
+	DrawMesh(shader, (const uint8_t*)ds_array_data(vertices), vn, 
+		(const uint16_t*)ds_array_data(indices), in, palette);
 }
 
 void Model3Shader::SetModelView(const sm::mat4& mat)
 {
-	for (int i = 0; i < PROG_COUNT; ++i) {
+	m_modelview = mat;
+	m_transform_slot = -1;
+	if (!m_palette_mode) {
+		ApplyModelView();
+	}
+}
+
+void Model3Shader::SetPalette(bool palette)
+{
+	if (m_palette_mode == palette) {
+		return;
+	}
+
+	FlushReasonScope scope(FR_OTHER);
+	Commit();
+	m_palette_mode = palette;
+	if (!m_palette_mode) {
+		ApplyModelView();
+	}
+}
+
+void Model3Shader::ApplyModelView() const
+{
+	const sm::mat4& mat = m_modelview;
+	for (int i = 0; i < PI_PALETTE_COLOR; ++i) {
 		ShaderProgram* prog = m_programs[i];
 		if (prog) {
 			prog->GetMVP()->SetModelview(&mat);
@@ -136,11 +179,136 @@ void Model3Shader::SetModelView(const sm::mat4& mat)
 	m_programs[PI_GOURAUD_TEXTURE]->GetShader()->SetUniform(m_shading_uniforms.normal_matrix, UNIFORM_FLOAT33, mat3.x);
 }
 
+bool Model3Shader::AcquireTransform() const
+{
+	if (m_transform_slot >= 0) {
+		return true;
+	}
+
+	bool flushed = false;
+	m_transform_slot = m_palette.Add(m_modelview);
+	if (m_transform_slot < 0) {
+		FlushReasonScope scope(FR_UNIFORM);
+		Commit();
+		m_transform_slot = m_palette.Add(m_modelview);
+		flushed = true;
+	}
+	return !flushed;
+}
+
+void Model3Shader::DrawMesh(RenderShader* shader, const uint8_t* vertices, int vn, 
+							const uint16_t* indices, int in, bool palette) const
+{
+	// flush before taking the index offset
+	const RenderBuffer *vb = shader->GetVertexBuffer(), *ib = shader->GetIndexBuffer();
+	if (ib->Size() + in > ib->Capacity()) {
+		FlushReasonScope scope(FR_IB_OVERFLOW);
+		Commit();
+	} else if (vb->Size() + vn > vb->Capacity()) {
+		FlushReasonScope scope(FR_VB_OVERFLOW);
+		Commit();
+	}
+	if (palette) {
+		AcquireTransform();
+	}
+
+	int ioffset = shader->GetVertexBuffer()->Size();
+	FrameArena* arena = FrameArena::Instance();
+	FrameArena::Scope scope(arena);
+	uint16_t* buf = (uint16_t*)arena->Alloc(sizeof(uint16_t) * in);
+	for (int i = 0; i < in; ++i) {
+		buf[i] = indices[i] + ioffset;
+	}
+	if (palette) {
+		shader->Draw(NULL, 0, buf, in);
+		AddPaletteVertices(shader, vertices, vn);
+	} else {
+		shader->Draw((void*)vertices, vn, buf, in);
+	}
+}
+
+void Model3Shader::DrawSplit(RenderShader* shader, const ds_array* vertices, 
+							 const ds_array* indices, bool palette) const
+{
+	int vcap = shader->GetVertexBuffer()->Capacity(),
+		icap = shader->GetIndexBuffer()->Capacity() / 3 * 3;
+	int stride = m_programs[m_curr_shader]->GetVertexSize();
+	if (palette) {
+		stride -= sizeof(float);
+	}
+
+	int vn = ds_array_size(vertices),
+		in = ds_array_size(indices);
+	const uint8_t* src_v = (const uint8_t*)ds_array_data(vertices);
+	const uint16_t* src_i = (const uint16_t*)ds_array_data(indices);
+
+	FrameArena* arena = FrameArena::Instance();
+	FrameArena::Scope scope(arena);
+	// source vertex to chunk vertex, -1 if not in the chunk
+	int* remap = (int*)arena->Alloc(sizeof(int) * vn);
+	memset(remap, 0xff, sizeof(int) * vn);
+	int* chunk_src = (int*)arena->Alloc(sizeof(int) * vcap);
+	uint8_t* chunk_v = (uint8_t*)arena->Alloc(stride * vcap);
+	uint16_t* chunk_i = (uint16_t*)arena->Alloc(sizeof(uint16_t) * icap);
+
+	// whole triangles, each chunk fills the empty buffers
+	int cvn = 0, cin = 0;
+	for (int i = 0; i + 3 <= in; i += 3) 
+	{
+		int add = 0;
+		for (int j = 0; j < 3; ++j) {
+			if (remap[src_i[i + j]] < 0) {
+				++add;
+			}
+		}
+		if (cvn + add > vcap || cin + 3 > icap) {
+			DrawMesh(shader, chunk_v, cvn, chunk_i, cin, palette);
+			for (int j = 0; j < cvn; ++j) {
+				remap[chunk_src[j]] = -1;
+			}
+			cvn = cin = 0;
+		}
+
+		for (int j = 0; j < 3; ++j) 
+		{
+			int src = src_i[i + j];
+			if (remap[src] < 0) {
+				remap[src] = cvn;
+				chunk_src[cvn] = src;
+				memcpy(chunk_v + cvn * stride, src_v + src * stride, stride);
+				++cvn;
+			}
+			chunk_i[cin++] = remap[src];
+		}
+	}
+	if (cin > 0) {
+		DrawMesh(shader, chunk_v, cvn, chunk_i, cin, palette);
+	}
+}
+
+void Model3Shader::AddPaletteVertices(RenderShader* shader, const uint8_t* vertices, int n) const
+{
+	const ShaderProgram* prog = m_programs[m_curr_shader];
+	int dst_sz = prog->GetVertexSize();
+	int src_sz = dst_sz - sizeof(float);
+
+	float idx = m_transform_slot;
+	const uint8_t* src = vertices;
+	uint8_t* dst = (uint8_t*)shader->Map(n);
+	for (int i = 0; i < n; ++i) {
+		memcpy(dst, src, src_sz);
+		memcpy(dst + src_sz, &idx, sizeof(float));
+		src += src_sz;
+		dst += dst_sz;
+	}
+}
+
 void Model3Shader::InitVAList()
 {
 	m_va_list[POSITION].Assign("position", 3, sizeof(float));
 	m_va_list[TEXCOORD].Assign("texcoord", 2, sizeof(float));
 	m_va_list[NORMAL].Assign("normal", 3, sizeof(float));	
+	m_va_list[PALETTE_IDX].Assign("palette_idx", 1, sizeof(float));
 }
 
 void Model3Shader::InitProgs()
@@ -150,6 +318,7 @@ void Model3Shader::InitProgs()
 	InitGouraudShadingProg(idx_buf);
  	InitTextureMapProg(idx_buf);
  	InitGouraudTextureProg(idx_buf);
+	InitPaletteProgs(idx_buf);
 	idx_buf->RemoveReference();
 }
 
@@ -228,6 +397,38 @@ void Model3Shader::InitGouraudTextureProg(RenderBuffer* idx_buf)
 	m_shading_uniforms.Init(m_programs[PI_GOURAUD_TEXTURE]->GetShader());
 }
 
+void Model3Shader::InitPaletteProgs(RenderBuffer* idx_buf)
+{
+	// static color
+	parser::Node* vert = new parser::PositionTransPalette(TransformPalette::CAPACITY, false);
+	parser::Node* frag = new parser::Assign(parser::Variable(parser::VT_FLOAT4, "_col_static_"), 0.5, 0.5, 0, 1);
+	frag->Connect(new parser::FragColor());
+
+	std::vector<VA_TYPE> va_types;
+	va_types.push_back(POSITION);
+	va_types.push_back(PALETTE_IDX);
+	m_programs[PI_PALETTE_COLOR] = CreateProg(vert, frag, va_types, idx_buf);
+
+	// texture map
+	vert = new parser::PositionTransPalette(TransformPalette::CAPACITY, false);
+	vert->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT2, "texcoord")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT2, "texcoord")));
+
+	frag = new parser::TextureMap();
+	frag->Connect(new parser::FragColor());
+
+	va_types.clear();
+	va_types.push_back(POSITION);
+	va_types.push_back(TEXCOORD);
+	va_types.push_back(PALETTE_IDX);
+	m_programs[PI_PALETTE_TEXTURE] = CreateProg(vert, frag, va_types, idx_buf);
+
+	for (int i = PI_PALETTE_COLOR; i <= PI_PALETTE_TEXTURE; ++i) {
+		TransformPalette::InitUniforms(m_programs[i]->GetShader(), m_palette_uniforms[i - PI_PALETTE_COLOR]);
+	}
+}
+
 ShaderProgram* Model3Shader::CreateProg(parser::Node* vert, parser::Node* frag, 
 										const std::vector<VA_TYPE>& va_types,
 										RenderBuffer* ib) const
@@ -2,6 +2,7 @@
 #define _SHADERLAB_MODEL3_SHADER_H_
 
 #include "Shader.h"
+#include "TransformPalette.h"
 #include "../render/VertexAttrib.h"
 
 #include <SM_Vector.h>
@@ -32,6 +33,7 @@ public:
 	virtual void Bind() const;
 	virtual void UnBind() const;
 	virtual void Commit() const;
+	virtual const SubjectMVP* GetSubject() const;
 
 	void SetMaterial(const sm::vec3& ambient, const sm::vec3& diffuse, 
 		const sm::vec3& specular, float shininess, int tex);
@@ -43,6 +45,13 @@ public:
 	// todo
 	void SetModelView(const sm::mat4& mat);
 
+	/**
+	 *  @brief
+	 *    unlit models take the modelview from a uniform palette by a 
+	 *    per-vertex index, so SetModelView() doesn't flush the batch
+	 */
+	void SetPalette(bool palette);
+
 private:
 	void InitVAList();
 	void InitProgs();
@@ -51,6 +60,17 @@ private:
 	void InitGouraudShadingProg(RenderBuffer* idx_buf);
 	void InitTextureMapProg(RenderBuffer* idx_buf);
 	void InitGouraudTextureProg(RenderBuffer* idx_buf);
+	void InitPaletteProgs(RenderBuffer* idx_buf);
+
+	void ApplyModelView() const;
+	bool AcquireTransform() const;
+	// the mesh fits the empty buffers
+	void DrawMesh(RenderShader* shader, const uint8_t* vertices, int vn, 
+		const uint16_t* indices, int in, bool palette) const;
+	// larger than the buffers, draw it in chunks of whole triangles
+	void DrawSplit(RenderShader* shader, const ds_array* vertices, 
+		const ds_array* indices, bool palette) const;
+	void AddPaletteVertices(RenderShader* shader, const uint8_t* vertices, int n) const;
 
 private:
 	enum PROG_IDX {
@@ -58,6 +78,8 @@ private:
 		PI_GOURAUD_SHADING,
 		PI_TEXTURE_MAP,
 		PI_GOURAUD_TEXTURE,
+		PI_PALETTE_COLOR,
+		PI_PALETTE_TEXTURE,
 		PROG_COUNT,
 	};
 
@@ -65,6 +87,7 @@ private:
 		POSITION = 0,
 		TEXCOORD,
 		NORMAL,
+		PALETTE_IDX,
 		VA_MAX_COUNT
 	};
 
@@ -90,6 +113,12 @@ private:
 
 	mutable int m_curr_shader;
 
+	bool m_palette_mode;
+	sm::mat4 m_modelview;
+	int m_palette_uniforms[2][TransformPalette::CAPACITY];
+	mutable TransformPalette m_palette;
+	mutable int m_transform_slot;
+
 }; // Model3Shader
 
 }
@@ -1,4 +1,5 @@
 #include "ObserverMVP.h"
+#include "SubjectMVP.h"
 #include "../render/RenderShader.h"
 
 #include <render/render.h>
@@ -8,17 +9,59 @@ namespace sl
 
 ObserverMVP::ObserverMVP(RenderShader* shader)
 	: m_shader(shader)
+	, m_modelview(-1)
+	, m_projection(-1)
+	, m_subject(NULL)
+	, m_modelview_version(0)
+	, m_projection_version(0)
 {
 }
 
+ObserverMVP::~ObserverMVP()
+{
+	if (m_subject) {
+		m_subject->UnRegister(this);
+	}
+}
+
+void ObserverMVP::SetSubject(SubjectMVP* subject)
+{
+	m_subject = subject;
+	m_modelview_version = m_projection_version = 0;
+}
+
 void ObserverMVP::SetModelview(const sm::mat4* mat)
 {
+	if (m_subject) {
+		m_modelview_version = m_subject->GetModelviewVersion();
+	}
 	m_shader->SetUniform(m_modelview, UNIFORM_FLOAT44, mat->x);
 }
 
 void ObserverMVP::SetProjection(const sm::mat4* mat)
 {
+	if (m_subject) {
+		m_projection_version = m_subject->GetProjectionVersion();
+	}
 	m_shader->SetUniform(m_projection, UNIFORM_FLOAT44, mat->x);
 }
 
+void ObserverMVP::Update()
+{
+	if (!m_subject) {
+		return;
+	}
+
+	// the subject flushed the draws of old matrices before changing,
+	// so the queued ones are all for the current
+	if (m_modelview_version != m_subject->GetModelviewVersion()) {
+		m_modelview_version = m_subject->GetModelviewVersion();
+		m_shader->SetUniform(m_modelview, UNIFORM_FLOAT44, m_subject->GetModelview().x, false);
+	}
+	if (m_projection_version != m_subject->GetProjectionVersion()) {
+		m_projection_version = m_subject->GetProjectionVersion();
+		m_shader->SetUniform(m_projection, UNIFORM_FLOAT44, m_subject->GetProjection().x, false);
+	}
+}
+
 }
\ No newline at end of file
@@ -7,23 +7,45 @@ namespace sl
 {
 
 class RenderShader;
+class SubjectMVP;
 
 class ObserverMVP
 {
 public:
 	ObserverMVP(RenderShader* shader);
+	~ObserverMVP();
 
 	void InitModelview(int id) { m_modelview = id; }
 	void InitProjection(int id) { m_projection = id; }
 
+	// uniform indices, -1 if none
+	int GetModelviewIndex() const { return m_modelview; }
+	int GetProjectionIndex() const { return m_projection; }
+
+	void SetSubject(SubjectMVP* subject);
+
+	/**
+	 *  @brief
+	 *    override the subject's matrix until it changes again
+	 */
 	void SetModelview(const sm::mat4* mat);
 	void SetProjection(const sm::mat4* mat);
 
+	/**
+	 *  @brief
+	 *    pull the subject's matrices if changed since the last time,
+	 *    called by RenderShader when bound or committed
+	 */
+	void Update();
+
 private:
 	RenderShader* m_shader;
 
 	int m_modelview, m_projection;
 
+	SubjectMVP* m_subject;
+	int m_modelview_version, m_projection_version;
+
 }; // ObserverMVP
 
 }
@@ -1,10 +1,13 @@
 #ifndef _SHADERLAB_SHADER_H_
 #define _SHADERLAB_SHADER_H_
 
+#include <stddef.h>
+
 namespace sl
 {
 
 class RenderContext;
+class SubjectMVP;
 
 class Shader
 {
@@ -15,6 +18,15 @@ public:
 	virtual void UnBind() const = 0;
 	virtual void Commit() const = 0;
 
+	// the matrices its programs observe, NULL if none
+	virtual const SubjectMVP* GetSubject() const { return NULL; }
+
+protected:
+	// StagingArena::FlushFunc for the quads staged by a shader
+	static void FlushStaging(void* owner) {
+		static_cast<const Shader*>(owner)->Commit();
+	}
+
 protected:
 	RenderContext* m_rc;
 
@@ -1,6 +1,9 @@
 #include "ShaderMgr.h"
 #include "Shader.h"
 #include "../render/RenderContext.h"
+#include "../render/RenderBackend.h"
+#include "../render/RenderStat.h"
+#include "../utility/Trace.h"
 
 #include <string.h>
 
@@ -26,28 +29,31 @@ ShaderMgr::ShaderMgr()
 
 ShaderMgr::~ShaderMgr()
 {
-	if (m_rc) {
-		delete m_rc;
-	}
-	for (int i = 0, n = MAX_SHADER; i < n; ++i) {
-		if (m_shaders[i]) {
-			delete m_shaders[i];
-		}
-	}
+	ReleaseContext();
 }
 
-int  ShaderMgr::CreateContext(int max_texture)
+int  ShaderMgr::CreateContext(int max_texture, RenderBackend* backend)
 {
 	if (m_rc) {
+		delete backend;
 		return 0;
 	} else {
-		m_rc = new RenderContext(max_texture);
+		m_rc = new RenderContext(max_texture, backend);
 		return 1;
 	}
 }
 
 void ShaderMgr::ReleaseContext()
 {
+	// shaders release their resources through the context
+	for (int i = 0, n = MAX_SHADER; i < n; ++i) {
+		if (m_shaders[i]) {
+			delete m_shaders[i];
+			m_shaders[i] = NULL;
+		}
+	}
+	m_curr_shader = -1;
+
 	delete m_rc;
 	m_rc = NULL;
 }
@@ -70,11 +76,14 @@ void ShaderMgr::ReleaseShader(ShaderType type)
 
 void ShaderMgr::SetShader(ShaderType type)
 {
+	SL_TRACE_SCOPE("ShaderMgr::SetShader");
+
 	if (type == m_curr_shader) {
 		return;
 	}
 
 	if (m_curr_shader != -1 && m_shaders[m_curr_shader]) {
+		FlushReasonScope scope(FR_SHADER);
 		m_shaders[m_curr_shader]->Commit();
 		m_shaders[m_curr_shader]->UnBind();
 	}
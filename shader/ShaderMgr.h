@@ -9,12 +9,14 @@ namespace sl
 {
 
 class RenderContext;
+class RenderBackend;
 class Shader;
 
 class ShaderMgr
 {
 public:
-	int  CreateContext(int max_texture);
+	int  CreateContext(int max_texture, RenderBackend* backend = NULL);
+	// also releases the shaders, they use the context
 	void ReleaseContext();
 	RenderContext* GetContext() { return m_rc; }
 
@@ -5,6 +5,7 @@
 #include "../render/RenderLayout.h"
 #include "../render/RenderShader.h"
 #include "../render/RenderBuffer.h"
+#include "../render/StreamRing.h"
 #include "../utility/Buffer.h"
 
 #include <render/render.h>
@@ -36,7 +37,7 @@ void ShaderProgram::Load(parser::Node* vert, parser::Node* frag,
 	m_shader = m_rc->CreateShader();
 	
 	// vertex layout
-	RenderLayout* lo = new RenderLayout(m_rc->GetEJRender(), va_list);
+	RenderLayout* lo = m_rc->FetchLayout(va_list);
 	m_shader->SetLayout(lo);
 	lo->RemoveReference();
 
@@ -45,10 +46,16 @@ void ShaderProgram::Load(parser::Node* vert, parser::Node* frag,
 	for (int i = 0, n = va_list.size(); i < n; ++i) {
 		m_vertex_sz += va_list[i].tot_size;
 	}
-	Buffer* buf = new Buffer(m_vertex_sz, m_max_vertex);
-	RenderBuffer* vb = new RenderBuffer(m_rc->GetEJRender(), VERTEXBUFFER, m_vertex_sz, m_max_vertex, buf);
+	Buffer* buf = new Buffer(m_vertex_sz, m_max_vertex, false);
+	RenderBuffer* vb = new RenderBuffer(m_rc->GetBackend(), VERTEXBUFFER, m_vertex_sz, m_max_vertex, buf);
+	StreamRing* ring = m_rc->FetchStreamRing(m_vertex_sz);
+	vb->SetStreaming(ring);
+	ring->RemoveReference();
 	m_shader->SetVertexBuffer(vb);
 	vb->RemoveReference();
+	StagingArena* arena = m_rc->GetVertexArena();
+	arena->Reserve(m_vertex_sz * m_max_vertex);
+	m_shader->SetStagingArena(arena);
 
 	// index buffer
 	if (ib) {
@@ -62,6 +69,7 @@ void ShaderProgram::Load(parser::Node* vert, parser::Node* frag,
 	m_mvp = new ObserverMVP(m_shader);
 	m_mvp->InitModelview(m_shader->AddUniform("u_modelview", UNIFORM_FLOAT44));
 	m_mvp->InitProjection(m_shader->AddUniform("u_projection", UNIFORM_FLOAT44));
+	m_shader->SetMVP(m_mvp);
 }
 
 void ShaderProgram::Release()
@@ -69,6 +77,7 @@ void ShaderProgram::Release()
 	delete m_parser;
 	m_shader->Unload();
 	if (m_mvp) {
+		m_shader->SetMVP(NULL);
 		delete m_mvp;
 	}
 }
@@ -2,7 +2,7 @@
 #include "ShaderProgram.h"
 #include "SubjectMVP2.h"
 #include "../render/RenderShader.h"
-#include "../utility/StackAllocator.h"
+#include "../utility/FrameArena.h"
 
 namespace sl
 {
@@ -17,10 +17,13 @@ Shape2Shader::Shape2Shader(RenderContext* rc)
 
 void Shape2Shader::Draw(const float* positions, int count) const
 {
-	StackAllocator* alloc = StackAllocator::Instance();
+	const SubjectMVP2* mvp = SubjectMVP2::Instance();
+	FrameArena* arena = FrameArena::Instance();
+	FrameArena::Scope scope(arena);
 	int sz = m_prog->GetVertexSize() * count;
-	alloc->Reserve(sz);
-	void* buf = alloc->Alloc(sz);
+	int trans_sz = mvp->IsPreTransform() ? sizeof(float) * 2 * count : 0;
+	void* buf = arena->Alloc(sz + trans_sz);
+	positions = mvp->Transform(positions, count, (float*)((uint8_t*)buf + sz));
 	uint8_t* ptr = (uint8_t*)buf;
  	for (int i = 0; i < count; ++i) 
  	{
@@ -32,15 +35,17 @@ void Shape2Shader::Draw(const float* positions, int count) const
  		ptr += sizeof(m_color);
  	}
  	m_prog->GetShader()->Draw(buf, count);
-	alloc->Free(buf);
 }
 
 void Shape2Shader::Draw(const float* positions, const uint32_t* colors, int count) const
 {
-	StackAllocator* alloc = StackAllocator::Instance();
+	const SubjectMVP2* mvp = SubjectMVP2::Instance();
+	FrameArena* arena = FrameArena::Instance();
+	FrameArena::Scope scope(arena);
 	int sz = m_prog->GetVertexSize() * count;
-	alloc->Reserve(sz);
-	void* buf = alloc->Alloc(sz);
+	int trans_sz = mvp->IsPreTransform() ? sizeof(float) * 2 * count : 0;
+	void* buf = arena->Alloc(sz + trans_sz);
+	positions = mvp->Transform(positions, count, (float*)((uint8_t*)buf + sz));
 	uint8_t* ptr = (uint8_t*)buf;
 	for (int i = 0; i < count; ++i) 
 	{
@@ -52,17 +57,17 @@ void Shape2Shader::Draw(const float* positions, const uint32_t* colors, int coun
 		ptr += sizeof(uint32_t);
 	}
 	m_prog->GetShader()->Draw(buf, count);
-	alloc->Free(buf);
 }
 
 void Shape2Shader::Draw(float x, float y, bool dummy) const
 {
+	float pos[2] = { x, y };
+	SubjectMVP2::Instance()->Transform(pos, 1, pos);
+
 	uint8_t buf[sizeof(float) * 2 + sizeof(int)];
 	uint8_t* ptr = buf;
-	memcpy(ptr, &x, sizeof(float));
-	ptr += sizeof(float);
-	memcpy(ptr, &y, sizeof(float));
-	ptr += sizeof(float);
+	memcpy(ptr, pos, sizeof(float) * 2);
+	ptr += sizeof(float) * 2;
 	if (dummy) {
 		memset(ptr, 0, sizeof(uint32_t));
 	} else {
@@ -72,6 +77,11 @@ void Shape2Shader::Draw(float x, float y, bool dummy) const
 	m_prog->GetShader()->Draw(buf, 1);
 }
 
+const SubjectMVP* Shape2Shader::GetSubject() const
+{
+	return SubjectMVP2::Instance();
+}
+
 void Shape2Shader::InitMVP(ObserverMVP* mvp) const
 {
 	SubjectMVP2::Instance()->Register(mvp);
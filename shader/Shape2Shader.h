@@ -11,6 +11,8 @@ class Shape2Shader : public ShapeShader
 public:
 	Shape2Shader(RenderContext* rc);	
 
+	virtual const SubjectMVP* GetSubject() const;
+
 	void Draw(const float* positions, int count) const;
 	void Draw(const float* positions, const uint32_t* colors, int count) const;
 	void Draw(float x, float y, bool dummy) const;
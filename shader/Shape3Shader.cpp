@@ -2,7 +2,7 @@
 #include "ShaderProgram.h"
 #include "SubjectMVP3.h"
 #include "../render/RenderShader.h"
-#include "../utility/StackAllocator.h"
+#include "../utility/FrameArena.h"
 
 namespace sl
 {
@@ -17,10 +17,10 @@ Shape3Shader::Shape3Shader(RenderContext* rc)
 
 void Shape3Shader::Draw(const float* positions, int count) const
 {
-	StackAllocator* alloc = StackAllocator::Instance();
+	FrameArena* arena = FrameArena::Instance();
+	FrameArena::Scope scope(arena);
 	int sz = m_prog->GetVertexSize() * count;
-	alloc->Reserve(sz);
-	void* buf = alloc->Alloc(sz);
+	void* buf = arena->Alloc(sz);
 	uint8_t* ptr = (uint8_t*)buf;
  	for (int i = 0; i < count; ++i) 
  	{
@@ -34,7 +34,6 @@ void Shape3Shader::Draw(const float* positions, int count) const
  		ptr += sizeof(m_color);
  	}
  	m_prog->GetShader()->Draw(buf, count);
-	alloc->Free(buf);
 }
 
 void Shape3Shader::Draw(float x, float y, float z, bool dummy) const
@@ -56,6 +55,11 @@ void Shape3Shader::Draw(float x, float y, float z, bool dummy) const
 	m_prog->GetShader()->Draw(buf, 1);
 }
 
+const SubjectMVP* Shape3Shader::GetSubject() const
+{
+	return SubjectMVP3::Instance();
+}
+
 void Shape3Shader::InitMVP(ObserverMVP* mvp) const
 {
 	SubjectMVP3::Instance()->Register(mvp);
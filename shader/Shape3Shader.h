@@ -11,6 +11,8 @@ class Shape3Shader : public ShapeShader
 public:
 	Shape3Shader(RenderContext* rc);	
 
+	virtual const SubjectMVP* GetSubject() const;
+
 	void Draw(const float* positions, int count) const;
 	void Draw(float x, float y, float z, bool dummy) const;
 
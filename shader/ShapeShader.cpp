@@ -6,6 +6,7 @@
 #include "../parser/VaryingNode.h"
 #include "../parser/FragColor.h"
 #include "../parser/AttributeNode.h"
+#include "../utility/Trace.h"
 
 #include <render/render.h>
 
@@ -36,6 +37,8 @@ void ShapeShader::UnBind() const
 
 void ShapeShader::Commit() const
 {
+	SL_TRACE_SCOPE("ShapeShader::Commit");
+
 	m_prog->GetShader()->Commit();
 }
 
@@ -1,14 +1,14 @@
 #include "Sprite2Shader.h"
 #include "SubjectMVP2.h"
 #include "ShaderProgram.h"
+#include "SpritePool.h"
 #include "../render/RenderShader.h"
 #include "../render/RenderBuffer.h"
 #include "../render/RenderContext.h"
-#include "../utility/StackAllocator.h"
-
-#ifdef SL_DC_STAT
-#include <iostream>
-#endif // SL_DC_STAT
+#include "../render/RenderStat.h"
+#include "../utility/Trace.h"
+#include "../utility/OverlapGrid.h"
+#include "../utility/VertexPack.h"
 
 #include <assert.h>
 
@@ -17,92 +17,189 @@ namespace sl
 
 static const int MAX_COMMBINE = 1024;
 
+static const float GRID_CELL_SIZE = 64;
+
 Sprite2Shader::Sprite2Shader(RenderContext* rc)
 	: SpriteShader(rc, 2, MAX_COMMBINE * 4, true)
+	, m_vertex_buf(NULL)
+	, m_reorder(false)
+	, m_batch_sz(0)
 {
 	InitProgs();
-	m_vertex_buf = new Vertex[MAX_COMMBINE * 4];
+	m_rc->GetQuadArena()->Reserve(sizeof(Vertex) * MAX_COMMBINE * 4);
+	m_batches = new Batch[MAX_COMMBINE];
+	m_quad_next = new int[MAX_COMMBINE];
+	m_grid = new OverlapGrid(GRID_CELL_SIZE);
+
+	ShaderProgram* progs[SpritePool::PROG_TYPE_COUNT];
+	for (int i = 0; i < SpritePool::PROG_TYPE_COUNT; ++i) {
+		progs[i] = GetProgram(i, false);
+	}
+	m_pool = new SpritePool(rc, progs);
+}
+
+Sprite2Shader::~Sprite2Shader()
+{
+	// everything the constructor allocates
+	m_rc->GetQuadArena()->Release(this);
+	delete[] m_batches;
+	delete[] m_quad_next;
+	delete m_grid;
+	delete m_pool;
 }
 
 void Sprite2Shader::Commit() const
 {
+	SL_TRACE_SCOPE("Sprite2Shader::Commit");
+
 	if (m_quad_sz == 0) {
 		return;
 	}
 
-	m_rc->SetTexture(m_texid, 0);
+	int batch_sz = m_batch_sz;
+	m_quad_sz = 0;
+	m_batch_sz = 0;
+	m_prog_type = 0;
+	if (m_reorder) {
+		m_grid->Clear();
+	}
 
-	ShaderProgram* prog = NULL;
-	switch (m_prog_type)
-	{
-	case PT_NULL:
-		prog = m_programs[PI_NO_COLOR];
-		break;
-	case PT_MULTI_ADD_COLOR:
-		prog = m_programs[PI_MULTI_ADD_COLOR];
-		break;
-	case PT_MAP_COLOR:
-		prog = m_programs[PI_MAP_COLOR];
-		break;
-	default:
-		assert((m_prog_type & PT_MULTI_ADD_COLOR) && (m_prog_type & PT_MAP_COLOR));
-		prog = m_programs[PI_FULL_COLOR];
-	}
-
-	int vertex_sz = prog->GetVertexSize();
-	int vb_count = m_quad_sz * 4;
-	int buf_sz = vertex_sz * vb_count;
-	StackAllocator* alloc = StackAllocator::Instance();
-	alloc->Reserve(buf_sz);
-	void* buf = alloc->Alloc(buf_sz);
-	uint8_t* ptr = (uint8_t*)buf;
-	if (m_prog_type == PT_MAP_COLOR) {
-		for (int i = 0; i < vb_count; ++i) {
-			memcpy(ptr, &m_vertex_buf[i].vx, sizeof(float) * 4);
-			ptr += sizeof(float) * 4;
-			memcpy(ptr, &m_vertex_buf[i].rmap, sizeof(uint32_t) * 3);
-			ptr += sizeof(uint32_t) * 3;
-		}
+	for (int i = 0; i < batch_sz; ++i) {
+		CommitBatch(m_batches[i]);
+	}
+	ClearQueued();
+}
+
+void Sprite2Shader::Draw(const float* positions, const float* texcoords, int texid) const
+{
+	float trans[8];
+	positions = SubjectMVP2::Instance()->Transform(positions, 4, trans);
+
+	if (m_quad_sz >= MAX_COMMBINE) {
+		FlushReasonScope scope(FR_VB_OVERFLOW);
+		Commit();
+	}
+
+	int batch, slot;
+	if (m_reorder) {
+		batch = FindBatch(positions, texid, slot);
 	} else {
-		for (int i = 0; i < vb_count; ++i) {
-			memcpy(ptr, &m_vertex_buf[i].vx, vertex_sz);
-			ptr += vertex_sz;
+		batch = AcquireSlot(texid, slot);
+	}
+	AddQuad(batch, slot, positions, texcoords);
+}
+
+void Sprite2Shader::DrawBatch(int n, const float* positions, const float* texcoords, const int* texids,
+							  const uint32_t* colors, const uint32_t* additives,
+							  const uint32_t* rmaps, const uint32_t* gmaps, const uint32_t* bmaps)
+{
+	uint32_t color = m_color, additive = m_additive;
+	uint32_t rmap = m_rmap, gmap = m_gmap, bmap = m_bmap;
+
+	const SubjectMVP2* mvp = SubjectMVP2::Instance();
+	float trans[8];
+
+	int i = 0;
+	while (i < n)
+	{
+		// one texture check per run
+		int texid = texids[i];
+		int batch = -1, slot = -1;
+		for ( ; i < n && texids[i] == texid; ++i)
+		{
+			if (colors) m_color = colors[i];
+			if (additives) m_additive = additives[i];
+			if (rmaps) m_rmap = rmaps[i];
+			if (gmaps) m_gmap = gmaps[i];
+			if (bmaps) m_bmap = bmaps[i];
+
+			const float* pos = mvp->Transform(positions + i * 8, 4, trans);
+			const float* tc = texcoords + i * 8;
+
+			if (m_quad_sz >= MAX_COMMBINE) {
+				FlushReasonScope scope(FR_VB_OVERFLOW);
+				Commit();
+				batch = -1;
+			}
+			if (m_reorder) {
+				int s;
+				AddQuad(FindBatch(pos, texid, s), s, pos, tc);
+				continue;
+			}
+			if (batch == -1 || !Accept(m_batches[batch])) {
+				batch = AcquireSlot(texid, slot);
+			}
+			AddQuad(batch, slot, pos, tc);
 		}
 	}
 
-	RenderShader* shader = prog->GetShader();
-	m_rc->BindShader(shader);
-	shader->Draw(buf, vb_count, NULL, m_quad_sz * 6);
-	alloc->Free(buf);
+	m_color = color;
+	m_additive = additive;
+	m_rmap = rmap;
+	m_gmap = gmap;
+	m_bmap = bmap;
+}
 
-	m_quad_sz = 0;
+void Sprite2Shader::SetReorder(bool reorder)
+{
+	if (m_reorder == reorder) {
+		return;
+	}
 
-	m_prog_type = 0;
+	FlushReasonScope scope(FR_OTHER);
+	Commit();
+	m_reorder = reorder;
+}
 
-	shader->Commit();
+int Sprite2Shader::CreatePoolSprite(const float* positions, const float* texcoords, int texid)
+{
+	return m_pool->Create(positions, texcoords, texid, 
+		m_color, m_additive, m_rmap, m_gmap, m_bmap);
 }
 
-void Sprite2Shader::Draw(const float* positions, const float* texcoords, int texid) const
+int Sprite2Shader::AcquireSlot(int texid, int& slot) const
 {
-	if (m_quad_sz >= MAX_COMMBINE || (m_texid != texid && m_texid != 0)) {
-#ifdef SL_DC_STAT
-		if (m_quad_sz >= MAX_COMMBINE) {
-			std::cout << "over MAX_COMMBINE\n";
-		} else {
-			std::cout << "tex " << m_texid << " to " << texid << "\n";
+	int batch = m_batch_sz - 1;
+	if (batch >= 0 && !Accept(m_batches[batch])) {
+		// batches go out in order, no need to commit
+		batch = AddBatch();
+		slot = AddTexture(m_batches[batch], texid);
+		return batch;
+	}
+	slot = batch < 0 ? -1 : AddTexture(m_batches[batch], texid);
+	if (slot < 0) {
+		if (m_batch_sz > 0) {
+			FlushReasonScope scope(FR_TEXTURE);
+			Commit();
 		}
-#endif // SL_DC_STAT
-		Commit();
+		batch = AddBatch();
+		slot = AddTexture(m_batches[batch], texid);
 	}
-	m_texid = texid;
+	return batch;
+}
+
+void Sprite2Shader::AddQuad(int batch, int slot, const float* positions, const float* texcoords) const
+{
+	Batch& b = m_batches[batch];
+
+	b.prog_type |= GetQuadProgType();
+	SetQueued(b.prog_type, b.tex_count > 1);
 
-	bool has_multi_add = (m_color != 0xffffffff) || ((m_additive & 0xffffff) != 0);
-	bool has_map = ((m_rmap & 0x00ffffff) != 0x000000ff) || ((m_gmap & 0x00ffffff) != 0x0000ff00) || ((m_bmap & 0x00ffffff) != 0x00ff0000);
-	if (has_multi_add) {
-		m_prog_type |= PT_MULTI_ADD_COLOR;
+	if (m_quad_sz == 0) {
+		FlushReasonScope scope(FR_OTHER);
+		void* owner = const_cast<Sprite2Shader*>(this);
+		m_vertex_buf = reinterpret_cast<Vertex*>(m_rc->GetQuadArena()->Borrow(owner, &Shader::FlushStaging));
 	}
-	if (has_map) {
-		m_prog_type |= PT_MAP_COLOR;
+
+	if (b.count == 0) {
+		b.color		= m_color;
+		b.additive	= m_additive;
+		b.rmap		= m_rmap;
+		b.gmap		= m_gmap;
+		b.bmap		= m_bmap;
+	} else if (b.const_color) {
+		b.const_color = b.color == m_color && b.additive == m_additive 
+			&& b.rmap == m_rmap && b.gmap == m_gmap && b.bmap == m_bmap;
 	}
 
 	for (int i = 0; i < 4; ++i) 
@@ -117,10 +214,197 @@ void Sprite2Shader::Draw(const float* positions, const float* texcoords, int tex
 		v->rmap		= m_rmap;
 		v->gmap		= m_gmap;
 		v->bmap		= m_bmap;
+		v->slot		= slot;
+	}
+
+	m_quad_next[m_quad_sz] = -1;
+	if (b.count == 0) {
+		b.first = m_quad_sz;
+	} else {
+		m_quad_next[b.last] = m_quad_sz;
 	}
+	b.last = m_quad_sz;
+	++b.count;
+
 	++m_quad_sz;
 }
 
+int Sprite2Shader::AddBatch() const
+{
+	Batch& b = m_batches[m_batch_sz];
+	b.tex_count = 0;
+	b.prog_type = 0;
+	b.const_color = true;
+	b.first = b.last = -1;
+	b.count = 0;
+	return m_batch_sz++;
+}
+
+int Sprite2Shader::AddTexture(Batch& b, int texid) const
+{
+	for (int i = 0; i < b.tex_count; ++i) {
+		if (b.textures[i] == texid) {
+			return i;
+		}
+	}
+	if (b.tex_count < (m_multi_tex ? MAX_TEXTURE_CHANNEL : 1)) {
+		b.textures[b.tex_count] = texid;
+		return b.tex_count++;
+	} else {
+		return -1;
+	}
+}
+
+void Sprite2Shader::CommitBatch(const Batch& b) const
+{
+	for (int i = 0; i < b.tex_count; ++i) {
+		m_rc->SetTexture(b.textures[i], i);
+	}
+
+	bool multi_tex = b.tex_count > 1;
+	// colors go as uniforms if the whole batch shares them
+	bool uniform_color = b.const_color && b.prog_type != PT_NULL;
+	int prog_idx = GetProgramIdx(b.prog_type, multi_tex, uniform_color);
+	ShaderProgram* prog = m_programs[prog_idx];
+
+	RenderShader* shader = prog->GetShader();
+	m_rc->BindShader(shader);
+	if (uniform_color) {
+		SetUniformColor(prog_idx, b.color, b.additive, b.rmap, b.gmap, b.bmap);
+	}
+
+	static const int W = sizeof(Vertex) / 4;
+	VertexPackFunc pack = NULL;
+	if (uniform_color) {
+		pack = multi_tex ? &VertexPack<W, 4, 9, 1>::Run : &VertexPack<W, 4, 0, 0>::Run;
+	} else if (multi_tex) {
+		pack = b.prog_type == PT_NULL ? &VertexPack<W, 4, 9, 1>::Run : &VertexPack<W, 10, 0, 0>::Run;
+	} else {
+		switch (b.prog_type)
+		{
+		case PT_NULL:
+			pack = &VertexPack<W, 4, 0, 0>::Run;
+			break;
+		case PT_MULTI_ADD_COLOR:
+			pack = &VertexPack<W, 6, 0, 0>::Run;
+			break;
+		case PT_MAP_COLOR:
+			pack = &VertexPack<W, 4, 6, 3>::Run;
+			break;
+		default:
+			pack = &VertexPack<W, 9, 0, 0>::Run;
+		}
+	}
+
+	uint8_t* ptr = (uint8_t*)shader->Map(b.count * 4, b.count * 6);
+	{
+		SL_TRACE_SCOPE("Sprite2Shader::Pack");
+
+		// consecutive quads in one call
+		int q = b.first;
+		while (q != -1) {
+			int begin = q;
+			while (m_quad_next[q] == q + 1) {
+				++q;
+			}
+			ptr = pack(ptr, &m_vertex_buf[begin * 4], (q - begin + 1) * 4);
+			q = m_quad_next[q];
+		}
+	}
+
+	shader->Commit();
+}
+
+int Sprite2Shader::FindBatch(const float* positions, int texid, int& slot) const
+{
+	float xmin = positions[0], xmax = positions[0],
+		  ymin = positions[1], ymax = positions[1];
+	for (int i = 1; i < 4; ++i) {
+		float x = positions[i * 2], y = positions[i * 2 + 1];
+		if (x < xmin) xmin = x;
+		if (x > xmax) xmax = x;
+		if (y < ymin) ymin = y;
+		if (y > ymax) ymax = y;
+	}
+
+	// must be drawn after the last batch it overlaps
+	int after = m_grid->Query(xmin, ymin, xmax, ymax);
+
+	// prefer a batch already has the texture, then one with free slot
+	int batch = -1;
+	slot = -1;
+	for (int i = m_batch_sz - 1; i >= 0 && i >= after; --i) {
+		const Batch& b = m_batches[i];
+		if (!Accept(b)) {
+			continue;
+		}
+		for (int j = 0; j < b.tex_count; ++j) {
+			if (b.textures[j] == texid) {
+				batch = i;
+				slot = j;
+				break;
+			}
+		}
+		if (batch != -1) {
+			break;
+		}
+	}
+	for (int i = m_batch_sz - 1; batch == -1 && i >= 0 && i >= after; --i) {
+		if (!Accept(m_batches[i])) {
+			continue;
+		}
+		slot = AddTexture(m_batches[i], texid);
+		if (slot != -1) {
+			batch = i;
+		}
+	}
+	if (batch == -1) {
+		batch = AddBatch();
+		slot = AddTexture(m_batches[batch], texid);
+	}
+
+	m_grid->Insert(xmin, ymin, xmax, ymax, batch);
+
+	return batch;
+}
+
+int Sprite2Shader::GetQuadProgType() const
+{
+	return GetProgType(m_color, m_additive, m_rmap, m_gmap, m_bmap);
+}
+
+bool Sprite2Shader::Accept(const Batch& b) const
+{
+	if (b.count == 0) {
+		return true;
+	}
+
+	int type = b.prog_type | GetQuadProgType();
+	bool const_color = b.const_color && b.color == m_color && b.additive == m_additive 
+		&& b.rmap == m_rmap && b.gmap == m_gmap && b.bmap == m_bmap;
+	if (type == b.prog_type && const_color == b.const_color) {
+		return true;
+	}
+
+	bool multi_tex = b.tex_count > 1;
+	float merge = CalcCost(type, const_color, multi_tex, b.count + 1);
+	float split = CalcCost(b.prog_type, b.const_color, multi_tex, b.count) 
+		+ CalcCost(GetQuadProgType(), true, false, 1) + m_cost.draw_call;
+	return merge <= split;
+}
+
+float Sprite2Shader::CalcCost(int prog_type, bool const_color, bool multi_tex, int count) const
+{
+	bool uniform_color = const_color && prog_type != PT_NULL;
+	int vertex_sz = GetProgram(prog_type, multi_tex, uniform_color)->GetVertexSize();
+	return count * (4 * vertex_sz * m_cost.vertex_byte + m_cost.fragment[prog_type]);
+}
+
+const SubjectMVP* Sprite2Shader::GetSubject() const
+{
+	return SubjectMVP2::Instance();
+}
+
 void Sprite2Shader::InitMVP(ObserverMVP* mvp) const
 {
 	SubjectMVP2::Instance()->Register(mvp);
@@ -2,19 +2,53 @@
 #define _SHADERLAB_SPRITE2_SHADER_H_
 
 #include "SpriteShader.h"
+#include "BatchCost.h"
 
 namespace sl
 {
 
+class OverlapGrid;
+class SpritePool;
+
 class Sprite2Shader : public SpriteShader
 {
 public:
 	Sprite2Shader(RenderContext* rc);	
+	virtual ~Sprite2Shader();
 
 	virtual void Commit() const;
+	virtual const SubjectMVP* GetSubject() const;
 
 	void Draw(const float* positions, const float* texcoords, int texid) const;
 
+	/**
+	 *  @brief
+	 *    n sprites, 8 floats of positions and texcoords each,
+	 *    color arrays can be NULL to use the current ones
+	 */
+	void DrawBatch(int n, const float* positions, const float* texcoords, const int* texids,
+		const uint32_t* colors, const uint32_t* additives, 
+		const uint32_t* rmaps, const uint32_t* gmaps, const uint32_t* bmaps);
+
+	/**
+	 *  @brief
+	 *    texture change don't commit, a quad is moved forward to an earlier 
+	 *    batch with the same texture if it overlaps nothing drawn after it
+	 */
+	void SetReorder(bool reorder);
+
+	/**
+	 *  @brief
+	 *    a quad with other colors joins a batch only if upgrading the 
+	 *    batch's program costs less than one more draw call
+	 */
+	void SetBatchCost(const BatchCost& cost) { m_cost = cost; }
+
+	// retained sprites, drawn by GetPool()->Draw()
+	SpritePool* GetPool() { return m_pool; }
+	// with the current colors
+	int CreatePoolSprite(const float* positions, const float* texcoords, int texid);
+
 protected:
 	virtual void InitMVP(ObserverMVP* mvp) const;
 
@@ -25,10 +59,58 @@ private:
 		float tx, ty;
 		uint32_t color, additive;
 		uint32_t rmap, gmap, bmap;
+		float slot;
+	};
+
+	struct Batch
+	{
+		int textures[MAX_TEXTURE_CHANNEL];
+		int tex_count;
+		int prog_type;
+		// colors of the first quad, valid for all if const_color
+		uint32_t color, additive;
+		uint32_t rmap, gmap, bmap;
+		bool const_color;
+		// quad index, linked by m_quad_next
+		int first, last;
+		int count;
 	};
 
 private:
-	Vertex* m_vertex_buf;
+	// without reorder, the last batch or a new one
+	int AcquireSlot(int texid, int& slot) const;
+	void AddQuad(int batch, int slot, const float* positions, const float* texcoords) const;
+
+	int AddBatch() const;
+	// -1 if no free slot
+	int AddTexture(Batch& b, int texid) const;
+
+	void CommitBatch(const Batch& b) const;
+
+	int FindBatch(const float* positions, int texid, int& slot) const;
+
+	// prog type of the current colors
+	int GetQuadProgType() const;
+	// the quad with current colors should join b rather than split
+	bool Accept(const Batch& b) const;
+	float CalcCost(int prog_type, bool const_color, bool multi_tex, int count) const;
+
+private:
+	// borrowed from the quad arena when staging the first quad
+	mutable Vertex* m_vertex_buf;
+
+	bool m_reorder;
+
+	// reorder window, owned
+	mutable Batch* m_batches;
+	mutable int m_batch_sz;
+	mutable int* m_quad_next;
+
+	OverlapGrid* m_grid;
+
+	BatchCost m_cost;
+
+	SpritePool* m_pool;
 
 }; // Sprite2Shader
 
@@ -4,7 +4,16 @@
 #include "../render/RenderShader.h"
 #include "../render/RenderBuffer.h"
 #include "../render/RenderContext.h"
-#include "../utility/StackAllocator.h"
+#include "../render/RenderStat.h"
+#include "../parser/PositionTransPalette.h"
+#include "../parser/AttributeNode.h"
+#include "../parser/VaryingNode.h"
+#include "../parser/MultiTextureMap.h"
+#include "../parser/ColorMap.h"
+#include "../parser/ColorAddMul.h"
+#include "../parser/FragColor.h"
+#include "../utility/Trace.h"
+#include "../utility/VertexPack.h"
 
 #include <assert.h>
 
@@ -14,77 +23,194 @@ namespace sl
 static const int MAX_VERTICES = 4096;
 
 Sprite3Shader::Sprite3Shader(RenderContext* rc)
-	: SpriteShader(rc, 3, MAX_VERTICES, false)
+	: SpriteShader(rc, 3, MAX_VERTICES, true)
+	, m_tex_count(0)
+	, m_palette_mode(false)
+	, m_transform_slot(-1)
 {
 	InitProgs();
-	m_vertex_buf = new Vertex[MAX_VERTICES];
+	InitPaletteProg();
+	m_vertex_buf = NULL;
+	m_rc->GetQuadArena()->Reserve(sizeof(Vertex) * MAX_VERTICES);
+	m_transform.Identity();
+}
+
+Sprite3Shader::~Sprite3Shader()
+{
+	m_rc->GetQuadArena()->Release(this);
+	delete m_palette_prog;
 }
 
 void Sprite3Shader::Commit() const
 {
+	SL_TRACE_SCOPE("Sprite3Shader::Commit");
+
 	if (m_quad_sz == 0) {
 		return;
 	}
 
-	m_rc->SetTexture(m_texid, 0);
+	for (int i = 0; i < m_tex_count; ++i) {
+		m_rc->SetTexture(m_textures[i], i);
+	}
 
-	ShaderProgram* prog = NULL;
-	switch (m_prog_type)
-	{
-	case PT_NULL:
-		prog = m_programs[PI_NO_COLOR];
-		break;
-	case PT_MULTI_ADD_COLOR:
-		prog = m_programs[PI_MULTI_ADD_COLOR];
-		break;
-	case PT_MAP_COLOR:
-		prog = m_programs[PI_MAP_COLOR];
-		break;
-	default:
-		assert((m_prog_type & PT_MULTI_ADD_COLOR) && (m_prog_type & PT_MAP_COLOR));
-		prog = m_programs[PI_FULL_COLOR];
-	}
-
-	int vertex_sz = prog->GetVertexSize();
-	int vb_count = m_quad_sz * 6;
-	int buf_sz = vertex_sz * vb_count;
-	StackAllocator* alloc = StackAllocator::Instance();
-	alloc->Reserve(buf_sz);
-	void* buf = alloc->Alloc(buf_sz);
-	uint8_t* ptr = (uint8_t*)buf;
-	if (m_prog_type == PT_MAP_COLOR) {
-		for (int i = 0; i < vb_count; ++i) {
-			memcpy(ptr, &m_vertex_buf[i].vx, sizeof(float) * 5);
-			ptr += sizeof(float) * 5;
-			memcpy(ptr, &m_vertex_buf[i].color, sizeof(uint32_t) * 2);
-			ptr += sizeof(uint32_t) * 2;
-		}
+	bool multi_tex = m_tex_count > 1;
+	ShaderProgram* prog = m_palette_mode ? m_palette_prog : GetProgram(m_prog_type, multi_tex);
+
+	RenderShader* shader = prog->GetShader();
+	m_rc->BindShader(shader);
+
+	static const int W = sizeof(Vertex) / 4;
+	VertexPackFunc pack = NULL;
+	if (m_palette_mode) {
+		pack = &VertexPack<W, 12, 0, 0>::Run;
+		m_palette.Upload(shader, m_palette_uniforms);
+	} else if (multi_tex) {
+		pack = m_prog_type == PT_NULL ? &VertexPack<W, 5, 10, 1>::Run : &VertexPack<W, 11, 0, 0>::Run;
 	} else {
-		for (int i = 0; i < vb_count; ++i) {
-			memcpy(ptr, &m_vertex_buf[i].vx, vertex_sz);
-			ptr += vertex_sz;
+		switch (m_prog_type)
+		{
+		case PT_NULL:
+			pack = &VertexPack<W, 5, 0, 0>::Run;
+			break;
+		case PT_MULTI_ADD_COLOR:
+			pack = &VertexPack<W, 7, 0, 0>::Run;
+			break;
+		case PT_MAP_COLOR:
+			pack = &VertexPack<W, 5, 7, 3>::Run;
+			break;
+		default:
+			pack = &VertexPack<W, 10, 0, 0>::Run;
 		}
 	}
 
-	RenderShader* shader = prog->GetShader();
-	m_rc->BindShader(shader);
-	shader->Draw(buf, vb_count);
-	alloc->Free(buf);
+	int vb_count = m_quad_sz * 4;
+	uint8_t* ptr = (uint8_t*)shader->Map(vb_count, m_quad_sz * 6);
+	{
+		SL_TRACE_SCOPE("Sprite3Shader::Pack");
+		pack(ptr, m_vertex_buf, vb_count);
+	}
 
 	m_quad_sz = 0;
+	m_tex_count = 0;
 
 	m_prog_type = 0;
 
+	m_palette.Clear();
+	m_transform_slot = -1;
+
 	shader->Commit();
+	ClearQueued();
 }
 
 void Sprite3Shader::Draw(const float* positions, const float* texcoords, int texid) const
 {
-	if (m_quad_sz * 6 >= MAX_VERTICES || (m_texid != texid && m_texid != 0)) {
+	if ((m_quad_sz + 1) * 4 > MAX_VERTICES) {
+		FlushReasonScope scope(FR_VB_OVERFLOW);
 		Commit();
 	}
-	m_texid = texid;
 
+	int slot = AcquireSlot(texid);
+	if (m_palette_mode && !AcquireTransform()) {
+		slot = AcquireSlot(texid);
+	}
+	AddQuad(slot, positions, texcoords);
+}
+
+void Sprite3Shader::DrawBatch(int n, const float* positions, const float* texcoords, const int* texids,
+							  const uint32_t* colors, const uint32_t* additives,
+							  const uint32_t* rmaps, const uint32_t* gmaps, const uint32_t* bmaps)
+{
+	uint32_t color = m_color, additive = m_additive;
+	uint32_t rmap = m_rmap, gmap = m_gmap, bmap = m_bmap;
+
+	int i = 0;
+	while (i < n)
+	{
+		// one texture check per run
+		int texid = texids[i];
+		int slot = -1;
+		for ( ; i < n && texids[i] == texid; ++i)
+		{
+			if (colors) m_color = colors[i];
+			if (additives) m_additive = additives[i];
+			if (rmaps) m_rmap = rmaps[i];
+			if (gmaps) m_gmap = gmaps[i];
+			if (bmaps) m_bmap = bmaps[i];
+
+			if ((m_quad_sz + 1) * 4 > MAX_VERTICES) {
+				FlushReasonScope scope(FR_VB_OVERFLOW);
+				Commit();
+				slot = -1;
+			}
+			if (slot == -1) {
+				slot = AcquireSlot(texid);
+			}
+			if (m_palette_mode && !AcquireTransform()) {
+				slot = AcquireSlot(texid);
+			}
+			AddQuad(slot, positions + i * 12, texcoords + i * 8);
+		}
+	}
+
+	m_color = color;
+	m_additive = additive;
+	m_rmap = rmap;
+	m_gmap = gmap;
+	m_bmap = bmap;
+}
+
+void Sprite3Shader::SetPalette(bool palette)
+{
+	if (m_palette_mode == palette) {
+		return;
+	}
+
+	FlushReasonScope scope(FR_OTHER);
+	Commit();
+	m_palette_mode = palette;
+}
+
+void Sprite3Shader::SetTransform(const sm::mat4& mat)
+{
+	m_transform = mat;
+	m_transform_slot = -1;
+}
+
+int Sprite3Shader::AcquireSlot(int texid) const
+{
+	for (int i = 0; i < m_tex_count; ++i) {
+		if (m_textures[i] == texid) {
+			return i;
+		}
+	}
+
+	if (m_tex_count >= (m_multi_tex ? MAX_TEXTURE_CHANNEL : 1)) {
+		FlushReasonScope scope(FR_TEXTURE);
+		Commit();
+	}
+	m_textures[m_tex_count] = texid;
+	return m_tex_count++;
+}
+
+bool Sprite3Shader::AcquireTransform() const
+{
+	if (m_transform_slot >= 0) {
+		return true;
+	}
+
+	bool flushed = false;
+	m_transform_slot = m_palette.Add(m_transform);
+	if (m_transform_slot < 0) {
+		FlushReasonScope scope(FR_UNIFORM);
+		Commit();
+		m_transform_slot = m_palette.Add(m_transform);
+		flushed = true;
+	}
+	return !flushed;
+}
+
+void Sprite3Shader::AddQuad(int slot, const float* positions, const float* texcoords) const
+{
 	bool has_multi_add = (m_color != 0xffffffff) || ((m_additive & 0xffffff) != 0);
 	bool has_map = ((m_rmap & 0x00ffffff) != 0x000000ff) || ((m_gmap & 0x00ffffff) != 0x0000ff00) || ((m_bmap & 0x00ffffff) != 0x00ff0000);
 	if (has_multi_add) {
@@ -93,10 +219,21 @@ void Sprite3Shader::Draw(const float* positions, const float* texcoords, int tex
 	if (has_map) {
 		m_prog_type |= PT_MAP_COLOR;
 	}
+	if (m_palette_mode) {
+		m_palette_prog->GetShader()->SetQueued(true);
+	} else {
+		SetQueued(m_prog_type, m_tex_count > 1);
+	}
 
-	for (int i = 0; i < 6; ++i) 
+	if (m_quad_sz == 0) {
+		FlushReasonScope scope(FR_OTHER);
+		void* owner = const_cast<Sprite3Shader*>(this);
+		m_vertex_buf = reinterpret_cast<Vertex*>(m_rc->GetQuadArena()->Borrow(owner, &Shader::FlushStaging));
+	}
+
+	for (int i = 0; i < 4; ++i) 
 	{
-		Vertex* v = &m_vertex_buf[m_quad_sz * 6 + i];
+		Vertex* v = &m_vertex_buf[m_quad_sz * 4 + i];
 		v->vx = positions[i * 3];
 		v->vy = positions[i * 3 + 1];
 		v->vz = positions[i * 3 + 2];
@@ -107,10 +244,60 @@ void Sprite3Shader::Draw(const float* positions, const float* texcoords, int tex
 		v->rmap = m_rmap;
 		v->gmap = m_gmap;
 		v->bmap = m_bmap;
+		v->slot = slot;
+		v->palette = m_transform_slot;
 	}
 	++m_quad_sz;
 }
 
+void Sprite3Shader::InitPaletteProg()
+{
+	parser::Node* vert = new parser::PositionTransPalette(TransformPalette::CAPACITY, true);
+	vert->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT2, "texcoord")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT2, "texcoord")))->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT4, "color")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT4, "color")))->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT4, "additive")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT4, "additive")))->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT4, "rmap")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT4, "rmap")))->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT4, "gmap")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT4, "gmap")))->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT4, "bmap")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT4, "bmap")))->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT1, "tex_slot")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT1, "tex_slot")));
+
+	parser::Node* frag = new parser::MultiTextureMap(MAX_TEXTURE_CHANNEL);
+	frag->Connect(
+		new parser::ColorMap())->Connect(
+		new parser::ColorAddMul())->Connect(
+		new parser::FragColor());
+
+	// all of the vertex, one program for every color and texture case
+	std::vector<VA_TYPE> va_types;
+	va_types.push_back(POSITION);
+	va_types.push_back(TEXCOORD);
+	va_types.push_back(COLOR);
+	va_types.push_back(ADDITIVE);
+	va_types.push_back(RMAP);
+	va_types.push_back(GMAP);
+	va_types.push_back(BMAP);
+	va_types.push_back(TEX_SLOT);
+	va_types.push_back(PALETTE_IDX);
+	m_palette_prog = CreateProg(vert, frag, va_types, m_index_buf);
+
+	RenderShader* shader = m_palette_prog->GetShader();
+	InitSamplers(shader);
+	TransformPalette::InitUniforms(shader, m_palette_uniforms);
+}
+
+const SubjectMVP* Sprite3Shader::GetSubject() const
+{
+	return SubjectMVP3::Instance();
+}
+
 void Sprite3Shader::InitMVP(ObserverMVP* mvp) const
 {
 	SubjectMVP3::Instance()->Register(mvp);
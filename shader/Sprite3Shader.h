@@ -2,6 +2,7 @@
 #define _SHADERLAB_SPRITE3_SHADER_H_
 
 #include "SpriteShader.h"
+#include "TransformPalette.h"
 
 namespace sl
 {
@@ -10,11 +11,32 @@ class Sprite3Shader : public SpriteShader
 {
 public:
 	Sprite3Shader(RenderContext* rc);	
+	virtual ~Sprite3Shader();
 
 	virtual void Commit() const;
+	virtual const SubjectMVP* GetSubject() const;
 
+	// 4 corners, 12 floats of positions and 8 of texcoords
 	void Draw(const float* positions, const float* texcoords, int texid) const;
 
+	/**
+	 *  @brief
+	 *    n sprites, 12 floats of positions and 8 of texcoords each,
+	 *    color arrays can be NULL to use the current ones
+	 */
+	void DrawBatch(int n, const float* positions, const float* texcoords, const int* texids,
+		const uint32_t* colors, const uint32_t* additives, 
+		const uint32_t* rmaps, const uint32_t* gmaps, const uint32_t* bmaps);
+
+	/**
+	 *  @brief
+	 *    per-vertex model matrix from a uniform palette, sprites with 
+	 *    different transforms are drawn in one call
+	 */
+	void SetPalette(bool palette);
+	// model matrix of the next sprites, only for palette mode
+	void SetTransform(const sm::mat4& mat);
+
 protected:
 	virtual void InitMVP(ObserverMVP* mvp) const;
 
@@ -25,10 +47,31 @@ private:
 		float tx, ty;
 		uint32_t color, additive;
 		uint32_t rmap, gmap, bmap;
+		float slot;
+		float palette;
 	};
 
 private:
-	Vertex* m_vertex_buf;
+	void InitPaletteProg();
+
+	int AcquireSlot(int texid) const;
+	// false if the palette was full and flushed
+	bool AcquireTransform() const;
+	void AddQuad(int slot, const float* positions, const float* texcoords) const;
+
+private:
+	// borrowed from the quad arena when staging the first quad
+	mutable Vertex* m_vertex_buf;
+
+	mutable int m_textures[MAX_TEXTURE_CHANNEL];
+	mutable int m_tex_count;
+
+	bool m_palette_mode;
+	ShaderProgram* m_palette_prog;
+	int m_palette_uniforms[TransformPalette::CAPACITY];
+	sm::mat4 m_transform;
+	mutable TransformPalette m_palette;
+	mutable int m_transform_slot;
 
 }; // Sprite3Shader
 
@@ -0,0 +1,290 @@
+#include "SpritePool.h"
+#include "SpriteShader.h"
+#include "SubjectMVP2.h"
+#include "ShaderProgram.h"
+#include "ObserverMVP.h"
+#include "ShaderType.h"
+#include "../render/RenderContext.h"
+#include "../render/RenderShader.h"
+#include "../render/RenderBuffer.h"
+#include "../render/RenderBackend.h"
+#include "../render/RenderStat.h"
+#include "../utility/Buffer.h"
+#include "../utility/Trace.h"
+#include "../utility/VertexPack.h"
+
+#include <render/render.h>
+
+#include <string.h>
+
+namespace sl
+{
+
+static const int W = 9;
+
+// by prog type: none, multi add, map, full
+static const VertexPackFunc PACK_FUNCS[SpritePool::PROG_TYPE_COUNT] = {
+	&VertexPack<W, 4, 0, 0>::Run,
+	&VertexPack<W, 6, 0, 0>::Run,
+	&VertexPack<W, 4, 6, 3>::Run,
+	&VertexPack<W, 9, 0, 0>::Run,
+};
+
+SpritePool::SpritePool(RenderContext* rc, ShaderProgram* const progs[PROG_TYPE_COUNT])
+	: m_rc(rc)
+	, m_index_buf(NULL)
+	, m_index_quads(0)
+{
+	memcpy(m_progs, progs, sizeof(m_progs));
+}
+
+SpritePool::~SpritePool()
+{
+	for (int i = 0, n = m_groups.size(); i < n; ++i) {
+		if (m_groups[i]->vb) {
+			m_groups[i]->vb->RemoveReference();
+		}
+		delete m_groups[i];
+	}
+	if (m_index_buf) {
+		m_index_buf->RemoveReference();
+	}
+}
+
+int SpritePool::Create(const float* positions, const float* texcoords, int texid, uint32_t color, 
+					   uint32_t additive, uint32_t rmap, uint32_t gmap, uint32_t bmap)
+{
+	int id;
+	if (m_free.empty()) {
+		id = m_sprites.size();
+		m_sprites.push_back(Sprite());
+	} else {
+		id = m_free.back();
+		m_free.pop_back();
+	}
+
+	Sprite& s = m_sprites[id];
+	for (int i = 0; i < 4; ++i) 
+	{
+		Vertex& v	= s.v[i];
+		v.vx		= positions[i * 2];
+		v.vy		= positions[i * 2 + 1];
+		v.tx		= texcoords[i * 2];
+		v.ty		= texcoords[i * 2 + 1];
+		v.color		= color;
+		v.additive	= additive;
+		v.rmap		= rmap;
+		v.gmap		= gmap;
+		v.bmap		= bmap;
+	}
+	s.texid = texid;
+
+	Insert(id);
+	return id;
+}
+
+void SpritePool::Release(int id)
+{
+	if (!IsValid(id)) {
+		return;
+	}
+	Remove(id);
+	m_free.push_back(id);
+}
+
+void SpritePool::SetPosition(int id, const float* positions)
+{
+	if (!IsValid(id)) {
+		return;
+	}
+	Sprite& s = m_sprites[id];
+	for (int i = 0; i < 4; ++i) {
+		s.v[i].vx = positions[i * 2];
+		s.v[i].vy = positions[i * 2 + 1];
+	}
+	Upload(id);
+}
+
+void SpritePool::SetTexcoord(int id, const float* texcoords, int texid)
+{
+	if (!IsValid(id)) {
+		return;
+	}
+	Sprite& s = m_sprites[id];
+	for (int i = 0; i < 4; ++i) {
+		s.v[i].tx = texcoords[i * 2];
+		s.v[i].ty = texcoords[i * 2 + 1];
+	}
+	if (texid == s.texid) {
+		Upload(id);
+	} else {
+		Remove(id);
+		s.texid = texid;
+		Insert(id);
+	}
+}
+
+void SpritePool::SetColor(int id, uint32_t color, uint32_t additive, 
+						  uint32_t rmap, uint32_t gmap, uint32_t bmap)
+{
+	if (!IsValid(id)) {
+		return;
+	}
+	Sprite& s = m_sprites[id];
+	for (int i = 0; i < 4; ++i) {
+		Vertex& v	= s.v[i];
+		v.color		= color;
+		v.additive	= additive;
+		v.rmap		= rmap;
+		v.gmap		= gmap;
+		v.bmap		= bmap;
+	}
+	int prog_type = SpriteShader::GetProgType(color, additive, rmap, gmap, bmap);
+	if (prog_type == m_groups[s.group]->prog_type) {
+		Upload(id);
+	} else {
+		Remove(id);
+		Insert(id);
+	}
+}
+
+void SpritePool::Draw() const
+{
+	SL_TRACE_SCOPE("SpritePool::Draw");
+
+	if (!m_rc->BeginDirectDraw()) {
+		return;
+	}
+
+	RenderBackend* backend = m_rc->GetBackend();
+	const SubjectMVP2* mvp = SubjectMVP2::Instance();
+	bool pre_trans = mvp->IsPreTransform();
+	sm::mat4 trans = mvp->GetTransform(), identity;
+	for (int i = 0, n = m_groups.size(); i < n; ++i)
+	{
+		const Group* g = m_groups[i];
+		int count = g->sprites.size();
+		if (count == 0) {
+			continue;
+		}
+
+		RenderShader* shader = m_progs[g->prog_type]->GetShader();
+		backend->Set(TEXTURE, g->texid, 0);
+		shader->Bind();
+
+		// stored untransformed
+		int modelview = shader->GetMVP()->GetModelviewIndex();
+		if (pre_trans) {
+			shader->SetUniform(modelview, UNIFORM_FLOAT44, trans.x, false);
+		}
+		shader->ApplyUniforms();
+
+		g->vb->Update();
+		shader->DrawRetained(DRAW_TRIANGLES, g->vb, m_index_buf, count * 6);
+		RenderStat::Instance()->AddDrawCall(SPRITE2, count * 4, 0);
+
+		if (pre_trans) {
+			shader->SetUniform(modelview, UNIFORM_FLOAT44, identity.x, false);
+		}
+	}
+
+	m_rc->EndDirectDraw();
+}
+
+bool SpritePool::IsValid(int id) const
+{
+	return id >= 0 && id < (int)m_sprites.size() && m_sprites[id].group >= 0;
+}
+
+void SpritePool::Insert(int id)
+{
+	Sprite& s = m_sprites[id];
+	const Vertex& v = s.v[0];
+	int prog_type = SpriteShader::GetProgType(v.color, v.additive, v.rmap, v.gmap, v.bmap);
+
+	s.group = FindGroup(s.texid, prog_type);
+	Group& g = *m_groups[s.group];
+	if ((int)g.sprites.size() == g.cap) {
+		Grow(g);
+	}
+	s.slot = g.sprites.size();
+	g.sprites.push_back(id);
+	g.vb->Add(NULL, 4);
+	Upload(id);
+}
+
+void SpritePool::Remove(int id)
+{
+	Sprite& s = m_sprites[id];
+	Group& g = *m_groups[s.group];
+
+	int last = g.sprites.size() - 1;
+	if (s.slot != last) {
+		int moved = g.sprites[last];
+		g.sprites[s.slot] = moved;
+		m_sprites[moved].slot = s.slot;
+		int stride = g.vb->Stride();
+		g.vb->Write(s.slot * 4, g.vb->Data() + last * 4 * stride, 4);
+	}
+	g.sprites.pop_back();
+	g.vb->Truncate(last * 4);
+
+	s.group = -1;
+}
+
+void SpritePool::Upload(int id)
+{
+	const Sprite& s = m_sprites[id];
+	Group& g = *m_groups[s.group];
+
+	uint8_t buf[sizeof(Vertex) * 4];
+	PACK_FUNCS[g.prog_type](buf, s.v, 4);
+	g.vb->Write(s.slot * 4, buf, 4);
+}
+
+int SpritePool::FindGroup(int texid, int prog_type)
+{
+	for (int i = 0, n = m_groups.size(); i < n; ++i) {
+		const Group* g = m_groups[i];
+		if (g->texid == texid && g->prog_type == prog_type && 
+			(int)g->sprites.size() < MAX_GROUP_QUADS) {
+			return i;
+		}
+	}
+
+	Group* g = new Group;
+	g->texid = texid;
+	g->prog_type = prog_type;
+	g->vb = NULL;
+	g->cap = 0;
+	m_groups.push_back(g);
+	return m_groups.size() - 1;
+}
+
+void SpritePool::Grow(Group& g)
+{
+	int cap = g.cap == 0 ? MIN_GROUP_QUADS : g.cap * 2;
+	if (cap > MAX_GROUP_QUADS) {
+		cap = MAX_GROUP_QUADS;
+	}
+
+	int stride = m_progs[g.prog_type]->GetVertexSize();
+	Buffer* buf = new Buffer(stride, cap * 4);
+	RenderBuffer* vb = new RenderBuffer(m_rc->GetBackend(), VERTEXBUFFER, stride, cap * 4, buf);
+	if (g.vb) {
+		vb->Add(g.vb->Data(), g.vb->Size());
+		g.vb->RemoveReference();
+	}
+	g.vb = vb;
+	g.cap = cap;
+
+	if (cap > m_index_quads) {
+		if (m_index_buf) {
+			m_index_buf->RemoveReference();
+		}
+		m_index_buf = m_rc->FetchQuadIndexBuffer(cap);
+		m_index_quads = cap;
+	}
+}
+
+}
\ No newline at end of file
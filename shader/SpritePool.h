@@ -0,0 +1,111 @@
+#ifndef _SHADERLAB_SPRITE_POOL_H_
+#define _SHADERLAB_SPRITE_POOL_H_
+
+#include <vector>
+
+#include <stdint.h>
+
+namespace sl
+{
+
+class RenderContext;
+class RenderBuffer;
+class ShaderProgram;
+
+/**
+ *  @brief
+ *    retained 2d sprites, created once and changed by handle
+ *
+ *  @remarks
+ *    sprites are packed on the device in groups of the same texture and
+ *    program type, a change only writes the sprite's 4 vertices and only 
+ *    the changed ranges are uploaded. Groups are drawn in creation order,
+ *    sprites in different groups don't keep painter's order. Positions are
+ *    not pre transformed, the current modelview is applied when drawing.
+ */
+class SpritePool
+{
+public:
+	static const int PROG_TYPE_COUNT = 4;
+
+public:
+	// progs index by prog type, the layouts without tex slot and uniform colors
+	SpritePool(RenderContext* rc, ShaderProgram* const progs[PROG_TYPE_COUNT]);
+	~SpritePool();
+
+	// 8 floats of positions and texcoords, return the handle
+	int  Create(const float* positions, const float* texcoords, int texid, uint32_t color, 
+		uint32_t additive, uint32_t rmap, uint32_t gmap, uint32_t bmap);
+	void Release(int id);
+
+	void SetPosition(int id, const float* positions);
+	void SetTexcoord(int id, const float* texcoords, int texid);
+	void SetColor(int id, uint32_t color, uint32_t additive, 
+		uint32_t rmap, uint32_t gmap, uint32_t bmap);
+
+	void Draw() const;
+
+private:
+	struct Vertex
+	{
+		float vx, vy;
+		float tx, ty;
+		uint32_t color, additive;
+		uint32_t rmap, gmap, bmap;
+	};
+
+	struct Sprite
+	{
+		Vertex v[4];
+		int texid;
+		// -1 if released
+		int group;
+		int slot;
+	};
+
+	struct Group
+	{
+		int texid;
+		int prog_type;
+		RenderBuffer* vb;
+		// in quads
+		int cap;
+		// sprite id of each slot
+		std::vector<int> sprites;
+	};
+
+private:
+	bool IsValid(int id) const;
+
+	void Insert(int id);
+	// the last sprite of the group takes the slot
+	void Remove(int id);
+	void Upload(int id);
+
+	int FindGroup(int texid, int prog_type);
+	void Grow(Group& g);
+
+private:
+	static const int MIN_GROUP_QUADS = 64;
+	// 16 bits indices
+	static const int MAX_GROUP_QUADS = 0x4000;
+
+private:
+	RenderContext* m_rc;
+
+	ShaderProgram* m_progs[PROG_TYPE_COUNT];
+
+	std::vector<Sprite> m_sprites;
+	std::vector<int> m_free;
+
+	std::vector<Group*> m_groups;
+
+	// shared quad indices, enough for the largest group
+	RenderBuffer* m_index_buf;
+	int m_index_quads;
+
+}; // SpritePool
+
+}
+
+#endif // _SHADERLAB_SPRITE_POOL_H_
\ No newline at end of file
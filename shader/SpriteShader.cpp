@@ -1,17 +1,18 @@
 #include "SpriteShader.h"
 #include "ObserverMVP.h"
-#include "Utility.h"
 #include "ShaderProgram.h"
 #include "ShaderMgr.h"
 #include "../render/RenderContext.h"
 #include "../render/RenderBuffer.h"
 #include "../render/RenderShader.h"
 #include "../render/RenderLayout.h"
+#include "../render/RenderStat.h"
 #include "../parser/Shader.h"
 #include "../parser/PositionTrans.h"
 #include "../parser/AttributeNode.h"
 #include "../parser/VaryingNode.h"
 #include "../parser/TextureMap.h"
+#include "../parser/MultiTextureMap.h"
 #include "../parser/FragColor.h"
 #include "../parser/ColorAddMul.h"
 #include "../parser/ColorMap.h"
@@ -19,12 +20,16 @@
 
 #include <render/render.h>
 
+#include <stdio.h>
+#include <assert.h>
+
 namespace sl
 {
 
 SpriteShader::SpriteShader(RenderContext* rc, int position_sz, int max_vertex,
 						   bool vertex_index)
 	: Shader(rc)
+	, m_index_buf(NULL)
 	, m_max_vertex(max_vertex)
 	, m_vertex_index(vertex_index)
 {
@@ -42,6 +47,8 @@ SpriteShader::SpriteShader(RenderContext* rc, int position_sz, int max_vertex,
 
 	m_prog_type = 0;
 
+	m_multi_tex = false;
+
 	InitVAList(position_sz);
 }
 
@@ -50,6 +57,9 @@ SpriteShader::~SpriteShader()
 	for (int i = 0; i < PROG_COUNT; ++i) {
 		delete m_programs[i];
 	}
+	if (m_index_buf) {
+		m_index_buf->RemoveReference();
+	}
 }
 
 void SpriteShader::Bind() const
@@ -78,18 +88,91 @@ void SpriteShader::SetColorMap(uint32_t rmap, uint32_t gmap, uint32_t bmap)
 	m_bmap = bmap;
 }
 
+void SpriteShader::SetMultiTexture(bool multi)
+{
+	if (m_multi_tex == multi) {
+		return;
+	}
+
+	FlushReasonScope scope(FR_OTHER);
+	Commit();
+	m_multi_tex = multi;
+}
+
 void SpriteShader::InitProgs()
 {
-	RenderBuffer* idx_buf = NULL;
 	if (m_vertex_index) {
-		idx_buf = Utility::CreateQuadIndexBuffer(m_rc, m_max_vertex / 4);
+		m_index_buf = m_rc->FetchQuadIndexBuffer(m_max_vertex / 4);
 	}
-	InitNoColorProg(idx_buf);
-	InitMultiAddColorProg(idx_buf);
-	InitMapColorProg(idx_buf);
-	InitFullColorProg(idx_buf);
-	if (m_vertex_index) {
-		idx_buf->RemoveReference();
+	InitNoColorProg(m_index_buf);
+	InitMultiAddColorProg(m_index_buf);
+	InitMapColorProg(m_index_buf);
+	InitFullColorProg(m_index_buf);
+	InitMultiTexProgs(m_index_buf);
+	InitUniformColorProgs(m_index_buf);
+}
+
+int SpriteShader::GetProgramIdx(int prog_type, bool multi_tex, bool uniform_color) const
+{
+	if (multi_tex) {
+		if (prog_type == PT_NULL) {
+			return PI_MT_NO_COLOR;
+		}
+		return uniform_color ? PI_MT_UNI_FULL_COLOR : PI_MT_FULL_COLOR;
+	}
+
+	switch (prog_type)
+	{
+	case PT_NULL:
+		return PI_NO_COLOR;
+	case PT_MULTI_ADD_COLOR:
+		return uniform_color ? PI_UNI_MULTI_ADD_COLOR : PI_MULTI_ADD_COLOR;
+	case PT_MAP_COLOR:
+		return uniform_color ? PI_UNI_MAP_COLOR : PI_MAP_COLOR;
+	default:
+		assert((prog_type & PT_MULTI_ADD_COLOR) && (prog_type & PT_MAP_COLOR));
+		return uniform_color ? PI_UNI_FULL_COLOR : PI_FULL_COLOR;
+	}
+}
+
+ShaderProgram* SpriteShader::GetProgram(int prog_type, bool multi_tex, bool uniform_color) const
+{
+	return m_programs[GetProgramIdx(prog_type, multi_tex, uniform_color)];
+}
+
+void SpriteShader::SetUniformColor(int prog_idx, uint32_t color, uint32_t additive, 
+								   uint32_t rmap, uint32_t gmap, uint32_t bmap) const
+{
+	m_color_uniforms[prog_idx].Set(m_programs[prog_idx]->GetShader(), 
+		color, additive, rmap, gmap, bmap);
+}
+
+int SpriteShader::GetProgType(uint32_t color, uint32_t additive, 
+							  uint32_t rmap, uint32_t gmap, uint32_t bmap)
+{
+	int type = PT_NULL;
+	bool has_multi_add = (color != 0xffffffff) || ((additive & 0xffffff) != 0);
+	bool has_map = ((rmap & 0x00ffffff) != 0x000000ff) || ((gmap & 0x00ffffff) != 0x0000ff00) || ((bmap & 0x00ffffff) != 0x00ff0000);
+	if (has_multi_add) {
+		type |= PT_MULTI_ADD_COLOR;
+	}
+	if (has_map) {
+		type |= PT_MAP_COLOR;
+	}
+	return type;
+}
+
+void SpriteShader::SetQueued(int prog_type, bool multi_tex) const
+{
+	// the batch may go out with either variant
+	GetProgram(prog_type, multi_tex, false)->GetShader()->SetQueued(true);
+	GetProgram(prog_type, multi_tex, true)->GetShader()->SetQueued(true);
+}
+
+void SpriteShader::ClearQueued() const
+{
+	for (int i = 0; i < PROG_COUNT; ++i) {
+		m_programs[i]->GetShader()->SetQueued(false);
 	}
 }
 
@@ -102,6 +185,8 @@ void SpriteShader::InitVAList(int position_sz)
 	m_va_list[RMAP].Assign("rmap", 4, sizeof(uint8_t));
 	m_va_list[GMAP].Assign("gmap", 4, sizeof(uint8_t));
 	m_va_list[BMAP].Assign("bmap", 4, sizeof(uint8_t));
+	m_va_list[TEX_SLOT].Assign("tex_slot", 1, sizeof(float));
+	m_va_list[PALETTE_IDX].Assign("palette_idx", 1, sizeof(float));
 }
 
 ShaderProgram* SpriteShader::CreateProg(parser::Node* vert, parser::Node* frag, 
@@ -224,4 +309,179 @@ void SpriteShader::InitFullColorProg(RenderBuffer* idx_buf)
 	m_programs[PI_FULL_COLOR] = CreateProg(vert, frag, va_types, idx_buf);
 }
 
+void SpriteShader::InitMultiTexProgs(RenderBuffer* idx_buf)
+{
+	// no color
+	parser::Node* vert = new parser::PositionTrans();
+	vert->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT2, "texcoord")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT2, "texcoord")))->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT1, "tex_slot")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT1, "tex_slot")));
+
+	parser::Node* frag = new parser::MultiTextureMap(MAX_TEXTURE_CHANNEL);
+	frag->Connect(new parser::FragColor());
+
+	std::vector<VA_TYPE> va_types;
+	va_types.push_back(POSITION);
+	va_types.push_back(TEXCOORD);
+	va_types.push_back(TEX_SLOT);
+	m_programs[PI_MT_NO_COLOR] = CreateProg(vert, frag, va_types, idx_buf);
+
+	// full color
+	vert = new parser::PositionTrans();
+	vert->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT2, "texcoord")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT2, "texcoord")))->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT4, "color")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT4, "color")))->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT4, "additive")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT4, "additive")))->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT4, "rmap")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT4, "rmap")))->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT4, "gmap")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT4, "gmap")))->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT4, "bmap")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT4, "bmap")))->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT1, "tex_slot")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT1, "tex_slot")));
+
+	frag = new parser::MultiTextureMap(MAX_TEXTURE_CHANNEL);
+	frag->Connect(
+		new parser::ColorMap())->Connect(
+		new parser::ColorAddMul())->Connect(
+		new parser::FragColor());
+
+	va_types.clear();
+	va_types.push_back(POSITION);
+	va_types.push_back(TEXCOORD);
+	va_types.push_back(COLOR);
+	va_types.push_back(ADDITIVE);
+	va_types.push_back(RMAP);
+	va_types.push_back(GMAP);
+	va_types.push_back(BMAP);
+	va_types.push_back(TEX_SLOT);
+	m_programs[PI_MT_FULL_COLOR] = CreateProg(vert, frag, va_types, idx_buf);
+
+	InitSamplers(m_programs[PI_MT_NO_COLOR]->GetShader());
+	InitSamplers(m_programs[PI_MT_FULL_COLOR]->GetShader());
+}
+
+void SpriteShader::InitUniformColorProgs(RenderBuffer* idx_buf)
+{
+	for (int i = 0; i < PROG_COUNT; ++i) {
+		ColorUniforms& u = m_color_uniforms[i];
+		u.color = u.additive = u.rmap = u.gmap = u.bmap = -1;
+	}
+
+	// the vertex only has position and texcoord, same as no color
+	parser::Node* vert = new parser::PositionTrans();
+	vert->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT2, "texcoord")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT2, "texcoord")));
+	parser::Node* frag = new parser::TextureMap();
+	frag->Connect(
+		new parser::ColorAddMul(true))->Connect(
+		new parser::FragColor());
+
+	std::vector<VA_TYPE> va_types;
+	va_types.push_back(POSITION);
+	va_types.push_back(TEXCOORD);
+	m_programs[PI_UNI_MULTI_ADD_COLOR] = CreateProg(vert, frag, va_types, idx_buf);
+
+	vert = new parser::PositionTrans();
+	vert->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT2, "texcoord")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT2, "texcoord")));
+	frag = new parser::TextureMap();
+	frag->Connect(
+		new parser::ColorMap(true))->Connect(
+		new parser::FragColor());
+	m_programs[PI_UNI_MAP_COLOR] = CreateProg(vert, frag, va_types, idx_buf);
+
+	vert = new parser::PositionTrans();
+	vert->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT2, "texcoord")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT2, "texcoord")));
+	frag = new parser::TextureMap();
+	frag->Connect(
+		new parser::ColorMap(true))->Connect(
+		new parser::ColorAddMul(true))->Connect(
+		new parser::FragColor());
+	m_programs[PI_UNI_FULL_COLOR] = CreateProg(vert, frag, va_types, idx_buf);
+
+	// multi texture
+	vert = new parser::PositionTrans();
+	vert->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT2, "texcoord")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT2, "texcoord")))->Connect(
+		new parser::AttributeNode(parser::Variable(parser::VT_FLOAT1, "tex_slot")))->Connect(
+		new parser::VaryingNode(parser::Variable(parser::VT_FLOAT1, "tex_slot")));
+	frag = new parser::MultiTextureMap(MAX_TEXTURE_CHANNEL);
+	frag->Connect(
+		new parser::ColorMap(true))->Connect(
+		new parser::ColorAddMul(true))->Connect(
+		new parser::FragColor());
+
+	va_types.push_back(TEX_SLOT);
+	m_programs[PI_MT_UNI_FULL_COLOR] = CreateProg(vert, frag, va_types, idx_buf);
+	InitSamplers(m_programs[PI_MT_UNI_FULL_COLOR]->GetShader());
+
+	for (int i = PI_UNI_MULTI_ADD_COLOR; i <= PI_MT_UNI_FULL_COLOR; ++i) {
+		m_color_uniforms[i].Init(m_programs[i]->GetShader());
+	}
+}
+
+void SpriteShader::InitSamplers(RenderShader* shader)
+{
+	for (int i = 0; i < MAX_TEXTURE_CHANNEL; ++i) 
+	{
+		char name[32];
+		sprintf(name, "u_texture%d", i);
+		int loc = shader->AddUniform(name, UNIFORM_INT1);
+		if (loc >= 0) {
+			float sample = i;
+			shader->SetUniform(loc, UNIFORM_INT1, &sample);
+		}
+	}
+}
+
+/************************************************************************/
+/* SpriteShader::ColorUniforms                                          */
+/************************************************************************/
+
+static void to_color(uint32_t col, float dst[4])
+{
+	dst[0] = (col & 0xff) / 255.0f;
+	dst[1] = ((col >> 8) & 0xff) / 255.0f;
+	dst[2] = ((col >> 16) & 0xff) / 255.0f;
+	dst[3] = ((col >> 24) & 0xff) / 255.0f;
+}
+
+void SpriteShader::ColorUniforms::Init(RenderShader* shader)
+{
+	color		= shader->AddUniform("u_color", UNIFORM_FLOAT4);
+	additive	= shader->AddUniform("u_additive", UNIFORM_FLOAT4);
+	rmap		= shader->AddUniform("u_rmap", UNIFORM_FLOAT4);
+	gmap		= shader->AddUniform("u_gmap", UNIFORM_FLOAT4);
+	bmap		= shader->AddUniform("u_bmap", UNIFORM_FLOAT4);
+}
+
+void SpriteShader::ColorUniforms::Set(RenderShader* shader, uint32_t color, uint32_t additive, 
+									  uint32_t rmap, uint32_t gmap, uint32_t bmap) const
+{
+	// set right before the program commits, nothing else to flush
+	float v[4];
+	to_color(color, v);
+	shader->SetUniform(this->color, UNIFORM_FLOAT4, v, false);
+	to_color(additive, v);
+	shader->SetUniform(this->additive, UNIFORM_FLOAT4, v, false);
+	to_color(rmap, v);
+	shader->SetUniform(this->rmap, UNIFORM_FLOAT4, v, false);
+	to_color(gmap, v);
+	shader->SetUniform(this->gmap, UNIFORM_FLOAT4, v, false);
+	to_color(bmap, v);
+	shader->SetUniform(this->bmap, UNIFORM_FLOAT4, v, false);
+}
+
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include "Shader.h"
 #include "../render/VertexAttrib.h"
+#include "../render/RenderConst.h"
 
 #include <string>
 #include <vector>
@@ -32,17 +33,49 @@ public:
 	void SetColor(uint32_t color, uint32_t additive);
 	void SetColorMap(uint32_t rmap, uint32_t gmap, uint32_t bmap);
 
+	/**
+	 *  @brief
+	 *    bind up to MAX_TEXTURE_CHANNEL textures for one batch,
+	 *    selected by a per-vertex slot
+	 */
+	void SetMultiTexture(bool multi);
+
+	// the cheapest program type for the colors
+	static int GetProgType(uint32_t color, uint32_t additive, 
+		uint32_t rmap, uint32_t gmap, uint32_t bmap);
+
 protected:
 	virtual void InitMVP(ObserverMVP* mvp) const = 0;
 
 	void InitProgs();
 
+	/**
+	 *  @param
+	 *    uniform_color		colors are the same for all the quads, 
+	 *    					take them as uniforms instead of attributes
+	 */
+	int GetProgramIdx(int prog_type, bool multi_tex, bool uniform_color = false) const;
+	ShaderProgram* GetProgram(int prog_type, bool multi_tex, bool uniform_color = false) const;
+
+	void SetUniformColor(int prog_idx, uint32_t color, uint32_t additive, 
+		uint32_t rmap, uint32_t gmap, uint32_t bmap) const;
+
+	// staged quads will be drawn with this program
+	void SetQueued(int prog_type, bool multi_tex) const;
+	void ClearQueued() const;
+
 protected:
 	enum PROG_IDX {
 		PI_NO_COLOR = 0,
 		PI_MULTI_ADD_COLOR,
 		PI_MAP_COLOR,
 		PI_FULL_COLOR,
+		PI_MT_NO_COLOR,
+		PI_MT_FULL_COLOR,
+		PI_UNI_MULTI_ADD_COLOR,
+		PI_UNI_MAP_COLOR,
+		PI_UNI_FULL_COLOR,
+		PI_MT_UNI_FULL_COLOR,
 		PROG_COUNT
 	};
 
@@ -60,12 +93,17 @@ protected:
 		RMAP,
 		GMAP,
 		BMAP,
+		TEX_SLOT,
+		PALETTE_IDX,
 		VA_MAX_COUNT
 	};
 
 	ShaderProgram* CreateProg(parser::Node* vert, parser::Node* frag, 
 		const std::vector<VA_TYPE>& va_types, RenderBuffer* ib) const;
 
+	// sampler i use channel i
+	static void InitSamplers(RenderShader* shader);
+
 private:
 	void InitVAList(int position_sz);
 
@@ -73,10 +111,25 @@ private:
 	void InitMultiAddColorProg(RenderBuffer* idx_buf);
 	void InitMapColorProg(RenderBuffer* idx_buf);
 	void InitFullColorProg(RenderBuffer* idx_buf);
+	void InitMultiTexProgs(RenderBuffer* idx_buf);
+	void InitUniformColorProgs(RenderBuffer* idx_buf);
+
+	struct ColorUniforms
+	{
+		int color, additive;
+		int rmap, gmap, bmap;
+
+		void Init(RenderShader* shader);
+		void Set(RenderShader* shader, uint32_t color, uint32_t additive, 
+			uint32_t rmap, uint32_t gmap, uint32_t bmap) const;
+	};
 
 protected:
 	ShaderProgram* m_programs[PROG_COUNT];
 
+	// shared quad indices, NULL without vertex_index
+	RenderBuffer* m_index_buf;
+
 	uint32_t m_color, m_additive;
 	uint32_t m_rmap, m_gmap, m_bmap;
 
@@ -86,12 +139,16 @@ protected:
 
 	mutable int m_prog_type;
 
+	bool m_multi_tex;
+
 private:
 	int m_max_vertex;
 	bool m_vertex_index;
 
 	VertexAttrib m_va_list[VA_MAX_COUNT];
 
+	ColorUniforms m_color_uniforms[PROG_COUNT];
+
 }; // SpriteShader
 
 }
@@ -0,0 +1,77 @@
+#include "SubjectMVP.h"
+#include "ObserverMVP.h"
+#include "ShaderMgr.h"
+#include "Shader.h"
+#include "../render/RenderStat.h"
+
+#include <string.h>
+
+namespace sl
+{
+
+SubjectMVP::SubjectMVP()
+	: m_modelview_version(1)
+	, m_projection_version(1)
+{
+	m_modelview.Identity();
+	m_projection.Identity();
+}
+
+void SubjectMVP::Register(ObserverMVP* observer)
+{
+	m_observers.insert(observer);
+	observer->SetSubject(this);
+}
+
+void SubjectMVP::UnRegister(ObserverMVP* observer)
+{
+	m_observers.erase(observer);
+	observer->SetSubject(NULL);
+}
+
+void SubjectMVP::Clear()
+{
+	std::set<ObserverMVP*>::iterator itr = m_observers.begin();
+	for ( ; itr != m_observers.end(); ++itr) {
+		(*itr)->SetSubject(NULL);
+	}
+	m_observers.clear();
+
+	m_modelview.Identity();
+	m_projection.Identity();
+	++m_modelview_version;
+	++m_projection_version;
+}
+
+void SubjectMVP::UpdateModelview(const sm::mat4& mat)
+{
+	if (memcmp(m_modelview.x, mat.x, sizeof(m_modelview.x)) == 0) {
+		return;
+	}
+	FlushPending();
+	m_modelview = mat;
+	++m_modelview_version;
+}
+
+void SubjectMVP::UpdateProjection(const sm::mat4& mat)
+{
+	if (memcmp(m_projection.x, mat.x, sizeof(m_projection.x)) == 0) {
+		return;
+	}
+	FlushPending();
+	m_projection = mat;
+	++m_projection_version;
+}
+
+void SubjectMVP::FlushPending() const
+{
+	// staged draws only live in the current shader, 
+	// they must go out with the old matrix
+	Shader* shader = ShaderMgr::Instance()->GetShader();
+	if (shader && shader->GetSubject() == this) {
+		FlushReasonScope scope(FR_UNIFORM);
+		shader->Commit();
+	}
+}
+
+}
\ No newline at end of file
@@ -10,25 +10,43 @@ namespace sl
 
 class ObserverMVP;
 
+/**
+ *  @brief
+ *    versioned matrices, observers pull them when their shader is bound
+ *    or committed, so a change costs O(1) instead of O(programs)
+ */
 class SubjectMVP
 {
 public:
-	void Register(ObserverMVP* observer) { m_observers.insert(observer); }
-	void UnRegister(ObserverMVP* observer) { m_observers.erase(observer); }
+	SubjectMVP();
 
-	void Clear() { 
-		m_observers.clear();
-		m_modelview.Identity();
-		m_projection.Identity();
-	}
+	void Register(ObserverMVP* observer);
+	void UnRegister(ObserverMVP* observer);
+
+	void Clear();
+
+	const sm::mat4& GetModelview() const { return m_modelview; }
+	const sm::mat4& GetProjection() const { return m_projection; }
+
+	int GetModelviewVersion() const { return m_modelview_version; }
+	int GetProjectionVersion() const { return m_projection_version; }
 
 protected:
+	void UpdateModelview(const sm::mat4& mat);
+	void UpdateProjection(const sm::mat4& mat);
+
+	// only if the current shader observes this
+	void FlushPending() const;
+
+private:
 	std::set<ObserverMVP*> m_observers;
 
 	sm::mat4 m_modelview, m_projection;
 
+	int m_modelview_version, m_projection_version;
+
 };	// SubjectMVP
 
 }
 
-#endif // _SHADERLAB_SUBJECT_MVP_H_
+#endif // _SHADERLAB_SUBJECT_MVP_H_
\ No newline at end of file
@@ -1,5 +1,4 @@
 #include "SubjectMVP2.h"
-#include "ObserverMVP.h"
 
 #include <stddef.h>
 
@@ -17,18 +16,21 @@ SubjectMVP2* SubjectMVP2::Instance()
 }
 
 SubjectMVP2::SubjectMVP2()
+	: m_pre_trans(false)
 {
-	m_modelview.Identity();
-	m_projection.Identity();
+	m_trans[0] = m_trans[1] = 1;
+	m_trans[2] = m_trans[3] = 0;
 }
 
 void SubjectMVP2::NotifyModelview(float x, float y, float sx, float sy)
 {
-	m_modelview = sm::mat4::Scaled(sx, sy, 1);
-	m_modelview.Translate(x * sx, y * sy, 0);
-	std::set<ObserverMVP*>::iterator itr = m_observers.begin();
-	for ( ; itr != m_observers.end(); ++itr) {
-		(*itr)->SetModelview(&m_modelview);
+	m_trans[0] = sx;
+	m_trans[1] = sy;
+	m_trans[2] = x * sx;
+	m_trans[3] = y * sy;
+	// staged vertices are transformed already
+	if (!m_pre_trans) {
+		ApplyModelview();
 	}
 }
 
@@ -36,11 +38,36 @@ void SubjectMVP2::NotifyProjection(int width, int height)
 {
 	float hw = width * 0.5f;
 	float hh = height * 0.5f;
-	m_projection = sm::mat4::Orthographic(-hw, hw, -hh, hh, 1, -1);
-	std::set<ObserverMVP*>::iterator itr = m_observers.begin();
-	for ( ; itr != m_observers.end(); ++itr) {
-		(*itr)->SetProjection(&m_projection);
+	UpdateProjection(sm::mat4::Orthographic(-hw, hw, -hh, hh, 1, -1));
+}
+
+void SubjectMVP2::SetPreTransform(bool pre_trans)
+{
+	if (m_pre_trans == pre_trans) {
+		return;
+	}
+
+	FlushPending();
+	m_pre_trans = pre_trans;
+	ApplyModelview();
+}
+
+sm::mat4 SubjectMVP2::GetTransform() const
+{
+	sm::mat4 mat = sm::mat4::Scaled(m_trans[0], m_trans[1], 1);
+	mat.Translate(m_trans[2], m_trans[3], 0);
+	return mat;
+}
+
+void SubjectMVP2::ApplyModelview()
+{
+	sm::mat4 mat;
+	if (m_pre_trans) {
+		mat.Identity();
+	} else {
+		mat = GetTransform();
 	}
+	UpdateModelview(mat);
 }
 
 }
\ No newline at end of file
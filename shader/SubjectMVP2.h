@@ -2,6 +2,7 @@
 #define _SHADERLAB_SUBJECT_MVP2_H_
 
 #include "SubjectMVP.h"
+#include "../utility/VertexPack.h"
 
 namespace sl
 {
@@ -12,11 +13,38 @@ public:
 	void NotifyModelview(float x, float y, float sx, float sy);
 	void NotifyProjection(int width, int height);
 
+	/**
+	 *  @brief
+	 *    apply the modelview to 2d positions on the cpu and keep only the
+	 *    projection on the gpu, so modelview changes don't break batches
+	 */
+	void SetPreTransform(bool pre_trans);
+	bool IsPreTransform() const { return m_pre_trans; }
+
+	// return positions itself when not in pre transform mode
+	const float* Transform(const float* positions, int n, float* buf) const {
+		if (!m_pre_trans) {
+			return positions;
+		}
+		pack::Transform2(buf, positions, n, m_trans);
+		return buf;
+	}
+
+	// the modelview also in pre transform mode
+	sm::mat4 GetTransform() const;
+
 	static SubjectMVP2* Instance();
 
 private:
 	SubjectMVP2();
 
+	void ApplyModelview();
+
+private:
+	bool m_pre_trans;
+	// sx, sy, tx, ty
+	float m_trans[4];
+
 private:
 	static SubjectMVP2* m_instance;
 
@@ -1,7 +1,6 @@
 #include "SubjectMVP3.h"
-#include "ObserverMVP.h"
 
-#include <string.h>
+#include <stddef.h>
 
 namespace sl
 {
@@ -18,26 +17,16 @@ SubjectMVP3* SubjectMVP3::Instance()
 
 SubjectMVP3::SubjectMVP3()
 {
-	m_modelview.Identity();
-	m_projection.Identity();
 }
 
 void SubjectMVP3::NotifyModelview(const sm::mat4& mat)
 {
-	m_modelview = mat;
-	std::set<ObserverMVP*>::iterator itr = m_observers.begin();
-	for ( ; itr != m_observers.end(); ++itr) {
-		(*itr)->SetModelview(&m_modelview);
-	}
+	UpdateModelview(mat);
 }
 
 void SubjectMVP3::NotifyProjection(const sm::mat4& mat)
 {
-	m_projection = mat;
-	std::set<ObserverMVP*>::iterator itr = m_observers.begin();
-	for ( ; itr != m_observers.end(); ++itr) {
-		(*itr)->SetProjection(&m_projection);
-	}
+	UpdateProjection(mat);
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "TransformPalette.h"
+#include "../render/RenderShader.h"
+
+#include <render/render.h>
+
+#include <stdio.h>
+#include <string.h>
+
+namespace sl
+{
+
+TransformPalette::TransformPalette()
+	: m_size(0)
+{
+}
+
+int TransformPalette::Add(const sm::mat4& mat)
+{
+	for (int i = m_size - 1; i >= 0; --i) {
+		if (memcmp(m_mats[i].x, mat.x, sizeof(mat.x)) == 0) {
+			return i;
+		}
+	}
+	if (m_size >= CAPACITY) {
+		return -1;
+	}
+	m_mats[m_size] = mat;
+	return m_size++;
+}
+
+void TransformPalette::InitUniforms(RenderShader* shader, int* uniforms)
+{
+	for (int i = 0; i < CAPACITY; ++i) {
+		char name[32];
+		sprintf(name, "u_palette[%d]", i);
+		uniforms[i] = shader->AddUniform(name, UNIFORM_FLOAT44);
+	}
+}
+
+void TransformPalette::Upload(RenderShader* shader, const int* uniforms) const
+{
+	// the values of the queued draws, so no flush
+	for (int i = 0; i < m_size; ++i) {
+		shader->SetUniform(uniforms[i], UNIFORM_FLOAT44, m_mats[i].x, false);
+	}
+}
+
+}
\ No newline at end of file
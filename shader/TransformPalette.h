@@ -0,0 +1,41 @@
+#ifndef _SHADERLAB_TRANSFORM_PALETTE_H_
+#define _SHADERLAB_TRANSFORM_PALETTE_H_
+
+#include <SM_Matrix.h>
+
+namespace sl
+{
+
+class RenderShader;
+
+/**
+ *  @brief
+ *    model matrices of one batch, selected by the per-vertex palette_idx
+ *    and uploaded to the program's u_palette[] when it commits
+ */
+class TransformPalette
+{
+public:
+	// 64 vec4 of the 128 guaranteed by gles2
+	static const int CAPACITY = 16;
+
+	TransformPalette();
+
+	// return the slot of mat, -1 if full
+	int Add(const sm::mat4& mat);
+	void Clear() { m_size = 0; }
+
+	bool Empty() const { return m_size == 0; }
+
+	static void InitUniforms(RenderShader* shader, int* uniforms);
+	void Upload(RenderShader* shader, const int* uniforms) const;
+
+private:
+	sm::mat4 m_mats[CAPACITY];
+	int m_size;
+
+}; // TransformPalette
+
+}
+
+#endif // _SHADERLAB_TRANSFORM_PALETTE_H_
\ No newline at end of file
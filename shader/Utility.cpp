@@ -1,5 +1,5 @@
 #include "Utility.h"
-#include "../utility/StackAllocator.h"
+#include "../utility/FrameArena.h"
 #include "../utility/Buffer.h"
 #include "../render/RenderBuffer.h"
 #include "../render/RenderContext.h"
@@ -11,16 +11,15 @@ namespace sl
 
 RenderBuffer* Utility::CreateIndexBuffer(RenderContext* rc, int count)
 {
-	StackAllocator* alloc = StackAllocator::Instance();
+	FrameArena* arena = FrameArena::Instance();
+	FrameArena::Scope scope(arena);
 	int sz = sizeof(uint16_t) * count;
-	alloc->Reserve(sz);
-	void* buf = alloc->Alloc(sz);
+	void* buf = arena->Alloc(sz);
 	uint16_t* ptr = (uint16_t*)buf;
 	memset(buf, 0, sz);
 	Buffer* index_buf = new Buffer(sizeof(uint16_t), count);
 	index_buf->Add(buf, count);
-	alloc->Free(buf);
-	RenderBuffer* ret = new RenderBuffer(rc->GetEJRender(), INDEXBUFFER, sizeof(uint16_t), count, index_buf);	
+	RenderBuffer* ret = new RenderBuffer(rc->GetBackend(), INDEXBUFFER, sizeof(uint16_t), count, index_buf);	
 	ret->Update();
     ret->Clear();
 	return ret;	
@@ -28,16 +27,15 @@ RenderBuffer* Utility::CreateIndexBuffer(RenderContext* rc, int count)
 
 RenderBuffer* Utility::CreateQuadIndexBuffer(RenderContext* rc, int quad_count)
 {
-	StackAllocator* alloc = StackAllocator::Instance();
+	FrameArena* arena = FrameArena::Instance();
+	FrameArena::Scope scope(arena);
 	int sz = sizeof(uint16_t) * 6 * quad_count;
-	alloc->Reserve(sz);
-	void* buf = alloc->Alloc(sz);
+	void* buf = arena->Alloc(sz);
 	uint16_t* ptr = (uint16_t*)buf;
 	FillingQuadIndexBuffer(ptr, quad_count);
 	Buffer* index_buf = new Buffer(sizeof(uint16_t), 6 * quad_count);
 	index_buf->Add(buf, 6 * quad_count);
-	alloc->Free(buf);
-	RenderBuffer* ret = new RenderBuffer(rc->GetEJRender(), INDEXBUFFER, sizeof(uint16_t), 6 * quad_count, index_buf);	
+	RenderBuffer* ret = new RenderBuffer(rc->GetBackend(), INDEXBUFFER, sizeof(uint16_t), 6 * quad_count, index_buf);	
 	ret->Update();
     ret->Clear();
 	return ret;
@@ -1,20 +1,155 @@
 #include "../utility/Buffer.h"
 
+#include <algorithm>
+
 namespace sl
 {
 
-Buffer::Buffer(int stride, int cap)
+Buffer::Buffer(int stride, int cap, bool own)
 	: m_stride(stride)
 	, m_capacity(cap)
 	, m_count(0)
-	, m_dirty(false)
+	, m_dirty_count(0)
+	, m_synced(0)
+	, m_own(own)
 {
-	m_buffer = new unsigned char[stride * cap];
+	m_buffer = own ? new unsigned char[stride * cap] : NULL;
 }
 
 Buffer::~Buffer()
 {
-	delete[] m_buffer;
+	if (m_own) {
+		delete[] m_buffer;
+	}
+}
+
+void Buffer::ResetDirty(bool mirrored)
+{
+	m_dirty_count = 0;
+	m_synced = (m_own && mirrored) ? m_count : 0;
+}
+
+void Buffer::Clear()
+{
+	// the dropped dirty elements are not the device ones any more
+	if (m_dirty_count > 0) {
+		m_synced = std::min(m_synced, m_dirty[0].begin);
+	}
+	m_dirty_count = 0;
+	m_count = 0;
+}
+
+void Buffer::Truncate(int n)
+{
+	if (n >= m_count) {
+		return;
+	}
+
+	while (m_dirty_count > 0 && m_dirty[m_dirty_count - 1].end > n) 
+	{
+		Range& r = m_dirty[m_dirty_count - 1];
+		m_synced = std::min(m_synced, std::max(r.begin, n));
+		if (r.begin < n) {
+			r.end = n;
+			break;
+		}
+		--m_dirty_count;
+	}
+	m_count = n;
+}
+
+void Buffer::Write(int from, const void* data, int n)
+{
+	int end = from + n;
+	if (!data || !m_buffer) {
+		if (end > m_synced) {
+			MarkDirty(std::max(from, m_synced), end);
+		}
+		return;
+	}
+
+	const unsigned char* src = static_cast<const unsigned char*>(data);
+	unsigned char* dst = m_buffer + m_stride * from;
+
+	// compare with the device copy, dirty the changed runs only
+	int synced = std::min(end, m_synced);
+	int run = -1;
+	for (int i = from; i < synced; ++i, src += m_stride, dst += m_stride) 
+	{
+		if (memcmp(dst, src, m_stride) == 0) {
+			if (run >= 0) {
+				MarkDirty(run, i);
+				run = -1;
+			}
+		} else {
+			memcpy(dst, src, m_stride);
+			if (run < 0) {
+				run = i;
+			}
+		}
+	}
+	if (run >= 0) {
+		MarkDirty(run, synced);
+	}
+
+	if (end > synced) {
+		int begin = std::max(from, synced);
+		memcpy(dst, src, m_stride * (end - begin));
+		MarkDirty(begin, end);
+	}
+}
+
+void Buffer::MarkDirty(int begin, int end)
+{
+	if (begin >= end) {
+		return;
+	}
+
+	// insert sorted, merge the overlapped and adjacent ones
+	int i = 0;
+	while (i < m_dirty_count && m_dirty[i].end < begin) {
+		++i;
+	}
+	int j = i;
+	while (j < m_dirty_count && m_dirty[j].begin <= end) {
+		begin = std::min(begin, m_dirty[j].begin);
+		end = std::max(end, m_dirty[j].end);
+		++j;
+	}
+	if (j == i && m_dirty_count == MAX_DIRTY) 
+	{
+		// full, join the two closest neighbours instead
+		int gap = -1, pos = 0;
+		for (int k = 0; k + 1 < m_dirty_count; ++k) {
+			int g = m_dirty[k + 1].begin - m_dirty[k].end;
+			if (gap < 0 || g < gap) {
+				gap = g;
+				pos = k;
+			}
+		}
+		m_dirty[pos].end = m_dirty[pos + 1].end;
+		for (int k = pos + 1; k + 1 < m_dirty_count; ++k) {
+			m_dirty[k] = m_dirty[k + 1];
+		}
+		--m_dirty_count;
+		MarkDirty(begin, end);
+		return;
+	}
+
+	// replace [i, j) with the merged one
+	int shift = 1 - (j - i);
+	if (shift > 0) {
+		for (int k = m_dirty_count - 1; k >= j; --k) {
+			m_dirty[k + shift] = m_dirty[k];
+		}
+	} else if (shift < 0) {
+		for (int k = j; k < m_dirty_count; ++k) {
+			m_dirty[k + shift] = m_dirty[k];
+		}
+	}
+	m_dirty_count += shift;
+	m_dirty[i].begin = begin;
+	m_dirty[i].end = end;
 }
 
 }
\ No newline at end of file
@@ -6,43 +6,109 @@
 namespace sl
 {
 
+/**
+ *  @brief
+ *    cpu copy of a device buffer, with the element ranges changed 
+ *    since the last upload
+ */
 class Buffer
 {
 public:
-	Buffer(int stride, int cap);
+	// [begin, end) in elements
+	struct Range
+	{
+		int begin, end;
+	};
+
+public:
+	/**
+	 *  @param
+	 *    own		false to write into memory set by SetStorage()
+	 */
+	Buffer(int stride, int cap, bool own = true);
 	~Buffer();
 
+	// at least stride * cap bytes, kept by the caller
+	void SetStorage(unsigned char* storage) { 
+		m_buffer = storage; 
+		m_synced = 0;
+	}
+
 	bool IsEmpty() const { return m_count == 0; }
 
-	bool IsDirty() const { return m_dirty; }
-	void ResetDirty() { m_dirty = false; }
+	bool IsDirty() const { return m_dirty_count > 0; }
+	// sorted and not adjacent
+	int GetDirtyCount() const { return m_dirty_count; }
+	const Range& GetDirty(int idx) const { return m_dirty[idx]; }
+	/**
+	 *  @param
+	 *    mirrored	false if the device copy isn't the same as the first 
+	 *    			Size() elements after the upload
+	 */
+	void ResetDirty(bool mirrored = true);
 
-	void Clear() { m_count = 0; }
+	void Clear();
+	// drop the elements from n
+	void Truncate(int n);
 	int Size() const { return m_count; }
 	int Capacity() const { return m_capacity; }
+	int Stride() const { return m_stride; }
 
 	const unsigned char* Data() const { return m_buffer; }
 
+	/**
+	 *  @param
+	 *    data		NULL to keep the memory, for the static content already uploaded
+	 *  @return
+	 *    true if no room
+	 */
 	bool Add(const void* data, int n) {
 		if (m_count + n > m_capacity) {
 			return true;
 		} else {
-			if (m_buffer && data) {
-				memcpy(m_buffer + m_stride * m_count, data, m_stride * n);
-			}
-			m_dirty = true;
+			Write(m_count, data, n);
 			m_count += n;
 			return false;
 		}
 	}
 
+	// append n elements to be written in place, NULL if no room
+	void* Map(int n) {
+		if (m_count + n > m_capacity) {
+			return NULL;
+		} else {
+			void* ret = m_buffer + m_stride * m_count;
+			MarkDirty(m_count, m_count + n);
+			m_count += n;
+			return ret;
+		}
+	}
+
+	/**
+	 *  @brief
+	 *    overwrite elements, only the ones differ from the device copy
+	 *    become dirty
+	 */
+	void Write(int from, const void* data, int n);
+
+	void MarkDirty(int begin, int end);
+
+private:
+	static const int MAX_DIRTY = 8;
+
 private:
 	unsigned char* m_buffer;
 
 	int m_stride, m_capacity;
 	int m_count;
 
-	bool m_dirty;
+	Range m_dirty[MAX_DIRTY];
+	int m_dirty_count;
+
+	// leading elements same as the device copy, always 0 for shared storage
+	int m_synced;
+
+	bool m_own;
 
 }; // Buffer
 
@@ -0,0 +1,122 @@
+#include "FrameArena.h"
+
+#include <assert.h>
+
+namespace sl
+{
+
+FrameArena* FrameArena::m_instance = NULL;
+
+FrameArena::FrameArena()
+	: m_curr(0)
+	, m_peak(0)
+	, m_last_peak(0)
+{
+	AddBlock(MIN_BLOCK_SIZE);
+}
+
+FrameArena::~FrameArena()
+{
+	for (int i = 0, n = m_blocks.size(); i < n; ++i) {
+		delete[] m_blocks[i].data;
+	}
+}
+
+void* FrameArena::Alloc(int sz, int align)
+{
+	assert(align > 0 && (align & (align - 1)) == 0);
+
+	while (true) 
+	{
+		Block& b = m_blocks[m_curr];
+		uintptr_t base = (uintptr_t)b.data;
+		uintptr_t ptr = (base + b.used + align - 1) & ~(uintptr_t)(align - 1);
+		int end = (int)(ptr - base) + sz;
+		if (end <= b.cap) {
+			b.used = end;
+
+			int in_use = 0;
+			for (int i = 0; i <= m_curr; ++i) {
+				in_use += m_blocks[i].used;
+			}
+			if (in_use > m_peak) {
+				m_peak = in_use;
+			}
+			return (void*)ptr;
+		}
+
+		// blocks after the current one are free after a rewind
+		if (m_curr + 1 < (int)m_blocks.size()) {
+			++m_curr;
+			m_blocks[m_curr].used = 0;
+			continue;
+		}
+
+		int cap = b.cap * 2;
+		if (cap < sz + align) {
+			cap = sz + align;
+		}
+		AddBlock(cap);
+		++m_curr;
+	}
+}
+
+FrameArena::Marker FrameArena::GetMarker() const
+{
+	Marker m;
+	m.block = m_curr;
+	m.offset = m_blocks[m_curr].used;
+	return m;
+}
+
+void FrameArena::Rewind(const Marker& marker)
+{
+	assert(marker.block <= m_curr);
+	m_curr = marker.block;
+	m_blocks[m_curr].used = marker.offset;
+}
+
+void FrameArena::Reset()
+{
+	if (m_blocks.size() > 1) {
+		int cap = GetCapacity();
+		for (int i = 0, n = m_blocks.size(); i < n; ++i) {
+			delete[] m_blocks[i].data;
+		}
+		m_blocks.clear();
+		AddBlock(cap);
+	}
+	m_curr = 0;
+	m_blocks[0].used = 0;
+
+	m_last_peak = m_peak;
+	m_peak = 0;
+}
+
+int FrameArena::GetCapacity() const
+{
+	int cap = 0;
+	for (int i = 0, n = m_blocks.size(); i < n; ++i) {
+		cap += m_blocks[i].cap;
+	}
+	return cap;
+}
+
+FrameArena* FrameArena::Instance()
+{
+	if (!m_instance) {
+		m_instance = new FrameArena;
+	}
+	return m_instance;
+}
+
+void FrameArena::AddBlock(int cap)
+{
+	Block b;
+	b.data = new uint8_t[cap];
+	b.cap = cap;
+	b.used = 0;
+	m_blocks.push_back(b);
+}
+
+}
\ No newline at end of file
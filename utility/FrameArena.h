@@ -0,0 +1,89 @@
+#ifndef _SHADERLAB_FRAME_ARENA_H_
+#define _SHADERLAB_FRAME_ARENA_H_
+
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace sl
+{
+
+/**
+ *  @brief
+ *    bump allocator for temporary buffers inside one frame
+ *
+ *  @remarks
+ *    allocations never move, a new block is chained when the current one
+ *    is full. Reset() at frame end merges the chain into one block, so
+ *    the next frame fits without growing.
+ */
+class FrameArena
+{
+public:
+	struct Marker
+	{
+		int block;
+		int offset;
+	};
+
+	// rewind to the position at construction
+	class Scope
+	{
+	public:
+		Scope(FrameArena* arena) : m_arena(arena), m_marker(arena->GetMarker()) {}
+		~Scope() { m_arena->Rewind(m_marker); }
+
+	private:
+		FrameArena* m_arena;
+		Marker m_marker;
+
+	}; // Scope
+
+public:
+	~FrameArena();
+
+	// never NULL
+	void* Alloc(int sz, int align = 16);
+
+	Marker GetMarker() const;
+	void Rewind(const Marker& marker);
+
+	// end of frame, all allocations must be released
+	void Reset();
+
+	// bytes in use at most during the last frame
+	int GetPeak() const { return m_last_peak; }
+	int GetCapacity() const;
+
+	static FrameArena* Instance();
+
+private:
+	FrameArena();
+
+	void AddBlock(int cap);
+
+private:
+	struct Block
+	{
+		uint8_t* data;
+		int cap;
+		int used;
+	};
+
+	static const int MIN_BLOCK_SIZE = 64 * 1024;
+
+private:
+	std::vector<Block> m_blocks;
+	int m_curr;
+
+	int m_peak, m_last_peak;
+
+private:
+	static FrameArena* m_instance;
+
+}; // FrameArena
+
+}
+
+#endif // _SHADERLAB_FRAME_ARENA_H_
\ No newline at end of file
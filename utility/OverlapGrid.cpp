@@ -0,0 +1,105 @@
+#include "OverlapGrid.h"
+
+#include <math.h>
+
+namespace sl
+{
+
+OverlapGrid::OverlapGrid(float cell_size)
+	: m_cell_size(cell_size)
+{
+}
+
+void OverlapGrid::Insert(float xmin, float ymin, float xmax, float ymax, int tag)
+{
+	Item item;
+	item.xmin = xmin;
+	item.ymin = ymin;
+	item.xmax = xmax;
+	item.ymax = ymax;
+	item.tag = tag;
+	int idx = m_items.size();
+	m_items.push_back(item);
+
+	int cx0, cy0, cx1, cy1;
+	if (!CellRange(xmin, ymin, xmax, ymax, cx0, cy0, cx1, cy1)) {
+		m_large.push_back(idx);
+		return;
+	}
+
+	for (int y = cy0; y <= cy1; ++y) {
+		for (int x = cx0; x <= cx1; ++x) {
+			int b = Hash(x, y);
+			if (m_buckets[b].empty()) {
+				m_dirty.push_back(b);
+			}
+			m_buckets[b].push_back(idx);
+		}
+	}
+}
+
+int OverlapGrid::Query(float xmin, float ymin, float xmax, float ymax) const
+{
+	int ret = -1;
+
+	for (int i = 0, n = m_large.size(); i < n; ++i) {
+		const Item& item = m_items[m_large[i]];
+		if (item.tag > ret && IsOverlap(item, xmin, ymin, xmax, ymax)) {
+			ret = item.tag;
+		}
+	}
+
+	int cx0, cy0, cx1, cy1;
+	if (!CellRange(xmin, ymin, xmax, ymax, cx0, cy0, cx1, cy1)) {
+		for (int i = 0, n = m_items.size(); i < n; ++i) {
+			const Item& item = m_items[i];
+			if (item.tag > ret && IsOverlap(item, xmin, ymin, xmax, ymax)) {
+				ret = item.tag;
+			}
+		}
+		return ret;
+	}
+
+	for (int y = cy0; y <= cy1; ++y) {
+		for (int x = cx0; x <= cx1; ++x) {
+			const std::vector<int>& bucket = m_buckets[Hash(x, y)];
+			for (int i = 0, n = bucket.size(); i < n; ++i) {
+				const Item& item = m_items[bucket[i]];
+				if (item.tag > ret && IsOverlap(item, xmin, ymin, xmax, ymax)) {
+					ret = item.tag;
+				}
+			}
+		}
+	}
+
+	return ret;
+}
+
+void OverlapGrid::Clear()
+{
+	for (int i = 0, n = m_dirty.size(); i < n; ++i) {
+		m_buckets[m_dirty[i]].clear();
+	}
+	m_dirty.clear();
+	m_large.clear();
+	m_items.clear();
+}
+
+bool OverlapGrid::CellRange(float xmin, float ymin, float xmax, float ymax, 
+							int& cx0, int& cy0, int& cx1, int& cy1) const
+{
+	float inv = 1.0f / m_cell_size;
+	float fx0 = floorf(xmin * inv), fx1 = floorf(xmax * inv),
+		  fy0 = floorf(ymin * inv), fy1 = floorf(ymax * inv);
+	// also false for nan
+	if (!((fx1 - fx0 + 1) * (fy1 - fy0 + 1) <= MAX_CELLS)) {
+		return false;
+	}
+	cx0 = (int)fx0;
+	cx1 = (int)fx1;
+	cy0 = (int)fy0;
+	cy1 = (int)fy1;
+	return true;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#ifndef _SHADERLAB_OVERLAP_GRID_H_
+#define _SHADERLAB_OVERLAP_GRID_H_
+
+#include <vector>
+
+namespace sl
+{
+
+/**
+ *  @brief
+ *    hashed uniform grid of tagged aabbs, answers "the max tag of the 
+ *    rects which overlap this one"
+ *
+ *  @remarks
+ *    touching edges are not overlapping, so tiles can share borders.
+ */
+class OverlapGrid
+{
+public:
+	OverlapGrid(float cell_size);
+
+	void Insert(float xmin, float ymin, float xmax, float ymax, int tag);
+
+	// -1 if no overlap
+	int Query(float xmin, float ymin, float xmax, float ymax) const;
+
+	void Clear();
+
+private:
+	struct Item
+	{
+		float xmin, ymin, xmax, ymax;
+		int tag;
+	};
+
+	bool CellRange(float xmin, float ymin, float xmax, float ymax, 
+		int& cx0, int& cy0, int& cx1, int& cy1) const;
+
+	static int Hash(int cx, int cy) {
+		return (((unsigned)cx * 73856093u) ^ ((unsigned)cy * 19349663u)) & (BUCKET_COUNT - 1);
+	}
+
+	static bool IsOverlap(const Item& item, float xmin, float ymin, float xmax, float ymax) {
+		return item.xmin < xmax && xmin < item.xmax 
+			&& item.ymin < ymax && ymin < item.ymax;
+	}
+
+private:
+	static const int BUCKET_COUNT = 256;
+
+	// rect covers more cells than this is kept in m_large
+	static const int MAX_CELLS = 16;
+
+private:
+	float m_cell_size;
+
+	std::vector<Item> m_items;
+
+	// index to m_items
+	std::vector<int> m_buckets[BUCKET_COUNT];
+	std::vector<int> m_large;
+
+	std::vector<int> m_dirty;
+
+}; // OverlapGrid
+
+}
+
+#endif // _SHADERLAB_OVERLAP_GRID_H_
\ No newline at end of file
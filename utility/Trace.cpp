@@ -0,0 +1,77 @@
+#include "Trace.h"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif // _WIN32
+
+namespace sl
+{
+
+Trace::Event* Trace::m_events = NULL;
+uint32_t Trace::m_head = 0;
+
+uint64_t Trace::Now()
+{
+#ifdef _WIN32
+	LARGE_INTEGER t;
+	QueryPerformanceCounter(&t);
+	return t.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif // _WIN32
+}
+
+bool Trace::Dump(const char* filepath)
+{
+	FILE* fp = fopen(filepath, "w");
+	if (!fp) {
+		return false;
+	}
+
+	// ticks to us
+#ifdef _WIN32
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	double scale = 1000000.0 / freq.QuadPart;
+#else
+	double scale = 0.001;
+#endif // _WIN32
+
+	fprintf(fp, "{\"traceEvents\":[");
+	if (m_events)
+	{
+		uint32_t start = m_head > SL_TRACE_CAPACITY ? m_head - SL_TRACE_CAPACITY : 0;
+		// scopes are recorded when they close, outer ones come after inner ones
+		uint64_t origin = m_events[start & (SL_TRACE_CAPACITY - 1)].begin;
+		for (uint32_t i = start; i < m_head; ++i) {
+			const Event& e = m_events[i & (SL_TRACE_CAPACITY - 1)];
+			if (e.begin < origin) {
+				origin = e.begin;
+			}
+		}
+		for (uint32_t i = start; i < m_head; ++i) 
+		{
+			const Event& e = m_events[i & (SL_TRACE_CAPACITY - 1)];
+			fprintf(fp, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f}",
+				i == start ? "" : ",", e.name, (e.begin - origin) * scale, (e.end - e.begin) * scale);
+		}
+	}
+	fprintf(fp, "\n]}\n");
+
+	fclose(fp);
+	return true;
+}
+
+void Trace::Init()
+{
+	m_events = new Event[SL_TRACE_CAPACITY];
+	m_head = 0;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef _SHADERLAB_TRACE_H_
+#define _SHADERLAB_TRACE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef SL_TRACE_CAPACITY
+// must be power of 2
+#define SL_TRACE_CAPACITY 65536
+#endif // SL_TRACE_CAPACITY
+
+namespace sl
+{
+
+/**
+ *  @brief
+ *    ring buffer of timed scopes, dumped as chrome trace json
+ *
+ *  @remarks
+ *    not thread safe, the head and the slots are plain memory without
+ *    locks or atomics. Record, dump and clear from the render thread only,
+ *    same as the rest of the library. When full the oldest events are
+ *    overwritten. Enabled by SL_TRACE at compile time.
+ */
+class Trace
+{
+public:
+	static uint64_t Now();
+
+	static void Record(const char* name, uint64_t begin, uint64_t end) {
+		if (!m_events) {
+			Init();
+		}
+		Event& e = m_events[m_head & (SL_TRACE_CAPACITY - 1)];
+		e.name = name;
+		e.begin = begin;
+		e.end = end;
+		++m_head;
+	}
+
+	// open with chrome://tracing
+	static bool Dump(const char* filepath);
+	static void Clear() { m_head = 0; }
+
+private:
+	static void Init();
+
+private:
+	struct Event
+	{
+		const char* name;
+		uint64_t begin, end;
+	};
+
+	static Event* m_events;
+	static uint32_t m_head;
+
+}; // Trace
+
+class TraceScope
+{
+public:
+	TraceScope(const char* name) 
+		: m_name(name), m_begin(Trace::Now()) {}
+	~TraceScope() { 
+		Trace::Record(m_name, m_begin, Trace::Now()); 
+	}
+
+private:
+	const char* m_name;
+	uint64_t m_begin;
+
+}; // TraceScope
+
+}
+
+#ifdef SL_TRACE
+#define SL_TRACE_SCOPE(name) sl::TraceScope _sl_trace_scope_(name)
+#define SL_TRACE_MARK(name) do { uint64_t _t_ = sl::Trace::Now(); sl::Trace::Record(name, _t_, _t_); } while (0)
+#else
+#define SL_TRACE_SCOPE(name)
+#define SL_TRACE_MARK(name)
+#endif // SL_TRACE
+
+#endif // _SHADERLAB_TRACE_H_
\ No newline at end of file
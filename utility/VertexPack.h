@@ -0,0 +1,141 @@
+#ifndef _SHADERLAB_VERTEX_PACK_H_
+#define _SHADERLAB_VERTEX_PACK_H_
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SL_PACK_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SL_PACK_NEON
+#include <arm_neon.h>
+#endif
+
+#include <string.h>
+#include <stdint.h>
+
+namespace sl
+{
+namespace pack
+{
+
+inline void Copy4(uint8_t* dst, const uint8_t* src)
+{
+#if defined(SL_PACK_SSE2)
+	_mm_storeu_si128((__m128i*)dst, _mm_loadu_si128((const __m128i*)src));
+#elif defined(SL_PACK_NEON)
+	vst1q_u8(dst, vld1q_u8(src));
+#else
+	memcpy(dst, src, 16);
+#endif
+}
+
+// copy N 32-bit words
+template <int N>
+struct Words
+{
+	static void Copy(uint8_t* dst, const uint8_t* src) {
+		Copy4(dst, src);
+		Words<N - 4>::Copy(dst + 16, src + 16);
+	}
+};
+
+template <>
+struct Words<3>
+{
+	static void Copy(uint8_t* dst, const uint8_t* src) { memcpy(dst, src, 12); }
+};
+
+template <>
+struct Words<2>
+{
+	static void Copy(uint8_t* dst, const uint8_t* src) { memcpy(dst, src, 8); }
+};
+
+template <>
+struct Words<1>
+{
+	static void Copy(uint8_t* dst, const uint8_t* src) { memcpy(dst, src, 4); }
+};
+
+template <>
+struct Words<0>
+{
+	static void Copy(uint8_t* dst, const uint8_t* src) {}
+};
+
+/**
+ *  @brief
+ *    n xy pairs, dst = src * scale + offset, trans is { sx, sy, tx, ty }
+ */
+inline void Transform2(float* dst, const float* src, int n, const float* trans)
+{
+	int i = 0;
+#if defined(SL_PACK_SSE2)
+	__m128 s = _mm_set_ps(trans[1], trans[0], trans[1], trans[0]);
+	__m128 t = _mm_set_ps(trans[3], trans[2], trans[3], trans[2]);
+	for ( ; i + 2 <= n; i += 2) {
+		__m128 p = _mm_loadu_ps(src + i * 2);
+		_mm_storeu_ps(dst + i * 2, _mm_add_ps(_mm_mul_ps(p, s), t));
+	}
+#elif defined(SL_PACK_NEON)
+	float32x2_t s2 = vld1_f32(trans);
+	float32x2_t t2 = vld1_f32(trans + 2);
+	float32x4_t s = vcombine_f32(s2, s2);
+	float32x4_t t = vcombine_f32(t2, t2);
+	for ( ; i + 2 <= n; i += 2) {
+		float32x4_t p = vld1q_f32(src + i * 2);
+		vst1q_f32(dst + i * 2, vmlaq_f32(t, p, s));
+	}
+#endif
+	for ( ; i < n; ++i) {
+		dst[i * 2]		= src[i * 2] * trans[0] + trans[2];
+		dst[i * 2 + 1]	= src[i * 2 + 1] * trans[1] + trans[3];
+	}
+}
+
+}
+
+typedef uint8_t* (*VertexPackFunc)(uint8_t* dst, const void* src, int n);
+
+/**
+ *  @brief
+ *    pack wide staging vertices to a program's layout
+ *
+ *  @remarks
+ *    every vertex is SRC words, output words [0, A) then [B_OFF, B_OFF + B_LEN).
+ *    Run() returns the end of dst.
+ */
+template <int SRC, int A, int B_OFF, int B_LEN>
+struct VertexPack
+{
+	static const int DST = A + B_LEN;
+
+	static void Vertex(uint8_t* dst, const uint8_t* src) {
+		pack::Words<A>::Copy(dst, src);
+		pack::Words<B_LEN>::Copy(dst + A * 4, src + B_OFF * 4);
+	}
+
+	static uint8_t* Run(uint8_t* dst, const void* src, int n) {
+		const uint8_t* s = static_cast<const uint8_t*>(src);
+		int i = 0;
+		// the 4 corners of a quad
+		for ( ; i + 4 <= n; i += 4) {
+			Vertex(dst, s);
+			Vertex(dst + DST * 4, s + SRC * 4);
+			Vertex(dst + DST * 8, s + SRC * 8);
+			Vertex(dst + DST * 12, s + SRC * 12);
+			dst += DST * 16;
+			s += SRC * 16;
+		}
+		for ( ; i < n; ++i) {
+			Vertex(dst, s);
+			dst += DST * 4;
+			s += SRC * 4;
+		}
+		return dst;
+	}
+
+}; // VertexPack
+
+}
+
+#endif // _SHADERLAB_VERTEX_PACK_H_
\ No newline at end of file